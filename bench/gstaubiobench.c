@@ -0,0 +1,390 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/* Throughput and latency benchmark of the aubio elements.
+ *
+ * Each case pushes a synthetic signal through
+ *   appsrc ! <element> ! fakesink  <element>.results ! appsink
+ * as fast as the element takes it, and prints one line of JSON with the
+ * throughput, the time spent per hop, the delay between the arrival on
+ * the sink pad of the element of the buffer holding the last sample a
+ * result needs and the reception of that result, and the heap
+ * allocations made per input buffer.
+ *
+ * Allocations are counted by interposing malloc, calloc and realloc over
+ * the ones of glibc, so run with G_SLICE=always-malloc in the environment
+ * for older GLib versions to route the slice allocator through them too,
+ * as "make bench" does. Elsewhere allocs_per_buffer is null. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+
+#include "gstaubioresults.h"
+
+typedef enum
+{
+  SIGNAL_SWEEP,
+  SIGNAL_CLICKS,
+  SIGNAL_NOISE
+} BenchSignal;
+
+static const gchar *signal_names[] = { "sweep", "clicks", "noise" };
+
+typedef struct
+{
+  const gchar *element;
+  BenchSignal signal;
+  guint buffer_frames;
+  guint channels;
+  guint hop_size;
+} BenchCase;
+
+/* state of a running case, shared with the results appsink thread */
+typedef struct
+{
+  const BenchCase *c;
+  guint rate;
+  guint n_buffers;
+  gint64 *arrived;              /* monotonic time each buffer reached the
+                                 * element */
+  guint results;
+  gdouble latency_sum;          /* in ns */
+  gint64 latency_max;
+} BenchRun;
+
+/* heap allocations of the whole process, GLib, GStreamer and aubio
+ * included */
+static volatile gint allocations = 0;
+
+#ifdef __GLIBC__
+#define HAVE_ALLOCATION_COUNT 1
+
+/* the implementation of glibc, under the names it exports it as */
+extern void *__libc_malloc (size_t n);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *mem, size_t n);
+
+void *
+malloc (size_t n)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_malloc (n);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *mem, size_t n)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_realloc (mem, n);
+}
+#endif
+
+static gint duration = 10;
+static gint rate = 44100;
+static gboolean quick = FALSE;
+
+static GOptionEntry entries[] = {
+  {"duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+      "Seconds of audio per case (default 10)", "S"},
+  {"rate", 'r', 0, G_OPTION_ARG_INT, &rate,
+      "Sample rate (default 44100)", "HZ"},
+  {"quick", 'q', 0, G_OPTION_ARG_NONE, &quick,
+      "Only run one buffer size and channel count", NULL},
+  {NULL}
+};
+
+/* fill data with frames interleaved frames of the given signal, the same
+ * on every channel */
+static void
+bench_fill (gfloat * data, BenchSignal signal, guint frames, guint channels,
+    guint rate)
+{
+  GRand *rand = g_rand_new_with_seed (0);
+  gdouble phase = 0.;
+  guint i, c, click = rate / 2;     /* 120 bpm */
+
+  for (i = 0; i < frames; i++) {
+    gfloat v = 0.;
+
+    switch (signal) {
+      case SIGNAL_SWEEP:{
+        /* logarithmic sweep from 50 Hz to 5 kHz */
+        gdouble f = 50. * pow (100., (gdouble) i / frames);
+
+        phase += 2. * G_PI * f / rate;
+        v = 0.5 * sin (phase);
+        break;
+      }
+      case SIGNAL_CLICKS:
+        v = (i % click) < rate / 1000 ? 0.9 : 0.;
+        break;
+      case SIGNAL_NOISE:
+        v = g_rand_double_range (rand, -0.5, 0.5);
+        break;
+    }
+    for (c = 0; c < channels; c++)
+      data[i * channels + c] = v;
+  }
+
+  g_rand_free (rand);
+}
+
+/* appsink "new-sample": match each result with the buffer holding the
+ * last sample it needed */
+static GstFlowReturn
+bench_new_results (GstAppSink * sink, BenchRun * run)
+{
+  GstSample *sample = gst_app_sink_pull_sample (sink);
+  const GstAubioResult *r;
+  gint64 now = g_get_monotonic_time ();
+  GstMapInfo map;
+  guint i, n;
+
+  if (sample == NULL)
+    return GST_FLOW_EOS;
+
+  gst_buffer_map (gst_sample_get_buffer (sample), &map, GST_MAP_READ);
+  r = (const GstAubioResult *) map.data;
+  n = map.size / sizeof (GstAubioResult);
+  for (i = 0; i < n; i++) {
+    guint64 frame = gst_util_uint64_scale_round (r[i].emitted, run->rate,
+        GST_SECOND);
+    guint index = MIN (frame / run->c->buffer_frames, run->n_buffers - 1);
+    gint64 latency = (now - run->arrived[index]) * 1000;
+
+    run->latency_sum += latency;
+    run->latency_max = MAX (run->latency_max, latency);
+    run->results++;
+  }
+  gst_buffer_unmap (gst_sample_get_buffer (sample), &map);
+  gst_sample_unref (sample);
+
+  return GST_FLOW_OK;
+}
+
+/* sink pad probe of the element: the reference time of the latency. The
+ * buffers are all queued in appsrc at once, the time they wait there is
+ * not part of the analysis. */
+static GstPadProbeReturn
+bench_buffer_arrived (GstPad * pad, GstPadProbeInfo * info, BenchRun * run)
+{
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  guint64 index = GST_BUFFER_OFFSET (buf) / run->c->buffer_frames;
+
+  if (index < run->n_buffers)
+    run->arrived[index] = g_get_monotonic_time ();
+
+  return GST_PAD_PROBE_OK;
+}
+
+static gboolean
+bench_run (const BenchCase * c)
+{
+  GstElement *pipeline, *src, *sink, *analysis;
+  GstPad *pad;
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  GstBuffer **buffers;
+  BenchRun run = { 0, };
+  gfloat *data;
+  gchar *desc;
+  guint frames, i, buf_size;
+  gint64 start, elapsed;
+  gint allocs;
+  gboolean ok;
+
+  /* windows as wide as the defaults of each element relative to the hop */
+  buf_size = c->hop_size * (g_str_equal (c->element, "aubiopitch") ? 8 : 2);
+
+  desc = g_strdup_printf ("appsrc name=src ! %s name=analysis message=false "
+      "buf-size=%u hop-size=%u ! fakesink analysis.results ! appsink "
+      "name=results sync=false emit-signals=true",
+      c->element, buf_size, c->hop_size);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (pipeline == NULL)
+    return FALSE;
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "results");
+  analysis = gst_bin_get_by_name (GST_BIN (pipeline), "analysis");
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
+      "layout", G_TYPE_STRING, "interleaved",
+      "rate", G_TYPE_INT, rate, "channels", G_TYPE_INT, c->channels, NULL);
+  gst_app_src_set_caps (GST_APP_SRC (src), caps);
+  gst_caps_unref (caps);
+  g_object_set (src, "format", GST_FORMAT_TIME, NULL);
+
+  run.c = c;
+  run.rate = rate;
+  run.n_buffers = (duration * rate + c->buffer_frames - 1) / c->buffer_frames;
+  run.arrived = g_new0 (gint64, run.n_buffers);
+  g_signal_connect (sink, "new-sample", G_CALLBACK (bench_new_results), &run);
+  pad = gst_element_get_static_pad (analysis, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) bench_buffer_arrived, &run, NULL);
+  gst_object_unref (pad);
+
+  /* the signal and the buffers around it are made before timing */
+  frames = run.n_buffers * c->buffer_frames;
+  data = g_new (gfloat, frames * c->channels);
+  bench_fill (data, c->signal, frames, c->channels, rate);
+  buffers = g_new (GstBuffer *, run.n_buffers);
+  for (i = 0; i < run.n_buffers; i++) {
+    gsize size = c->buffer_frames * c->channels * sizeof (gfloat);
+
+    buffers[i] = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        data + i * c->buffer_frames * c->channels, size, 0, size, NULL, NULL);
+    GST_BUFFER_PTS (buffers[i]) = gst_util_uint64_scale_int
+        (i * c->buffer_frames, GST_SECOND, rate);
+    GST_BUFFER_DURATION (buffers[i]) = gst_util_uint64_scale_int
+        (c->buffer_frames, GST_SECOND, rate);
+    GST_BUFFER_OFFSET (buffers[i]) = i * c->buffer_frames;
+  }
+
+  /* not waiting for the state change: the sinks only preroll once the
+   * buffers are in, completion is the EOS message below */
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  allocs = g_atomic_int_get (&allocations);
+  start = g_get_monotonic_time ();
+  for (i = 0; i < run.n_buffers; i++) {
+    gst_app_src_push_buffer (GST_APP_SRC (src), buffers[i]);
+  }
+  gst_app_src_end_of_stream (GST_APP_SRC (src));
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = (g_get_monotonic_time () - start) * 1000;
+  allocs = g_atomic_int_get (&allocations) - allocs;
+  ok = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  if (ok) {
+    gchar *allocs_str;
+
+#ifdef HAVE_ALLOCATION_COUNT
+    allocs_str = g_strdup_printf ("%.2f", (gdouble) allocs / run.n_buffers);
+#else
+    allocs_str = g_strdup ("null");
+#endif
+    g_print ("{\"element\": \"%s\", \"signal\": \"%s\", \"buffer\": %u, "
+        "\"channels\": %u, \"hop\": %u, \"window\": %u, \"frames\": %u, "
+        "\"seconds\": %.6f, \"samples_per_sec\": %.1f, "
+        "\"ns_per_hop\": %.1f, \"results\": %u, "
+        "\"latency_mean_ns\": %.1f, \"latency_max_ns\": %" G_GINT64_FORMAT
+        ", \"allocs_per_buffer\": %s}\n",
+        c->element, signal_names[c->signal], c->buffer_frames, c->channels,
+        c->hop_size, buf_size, frames, elapsed * 1.e-9,
+        (gdouble) frames * c->channels / (elapsed * 1.e-9),
+        (gdouble) elapsed / (frames / c->hop_size), run.results,
+        run.results ? run.latency_sum / run.results : 0., run.latency_max,
+        allocs_str);
+    g_free (allocs_str);
+  }
+
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (analysis);
+  gst_object_unref (pipeline);
+  g_free (buffers);
+  g_free (data);
+  g_free (run.arrived);
+
+  return ok;
+}
+
+int
+main (int argc, char *argv[])
+{
+  static const gchar *elements[] = { "aubiopitch", "aubiotempo" };
+  static const guint buffer_sizes[] = { 64, 512, 4096 };
+  static const guint channel_counts[] = { 1, 2, 8 };
+  static const guint hop_sizes[] = { 128, 256, 512 };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint e, s, b, n, h;
+  gboolean ok = TRUE;
+
+  ctx = g_option_context_new ("- benchmark the aubio elements");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  for (e = 0; e < G_N_ELEMENTS (elements); e++) {
+    for (s = 0; s < G_N_ELEMENTS (signal_names); s++) {
+      for (b = 0; b < G_N_ELEMENTS (buffer_sizes); b++) {
+        for (n = 0; n < G_N_ELEMENTS (channel_counts); n++) {
+          for (h = 0; h < G_N_ELEMENTS (hop_sizes); h++) {
+            BenchCase c;
+
+            if (quick && (b != 1 || n != 1))
+              continue;
+
+            c.element = elements[e];
+            c.signal = s;
+            c.buffer_frames = buffer_sizes[b];
+            c.channels = channel_counts[n];
+            c.hop_size = hop_sizes[h];
+            if (!bench_run (&c)) {
+              g_printerr ("%s failed on %s, buffer %u, %u channels, "
+                  "hop %u\n", c.element, signal_names[s], c.buffer_frames,
+                  c.channels, c.hop_size);
+              ok = FALSE;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return ok ? 0 : 1;
+}
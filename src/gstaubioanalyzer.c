@@ -0,0 +1,813 @@
+/*
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+ * SECTION:element-aubioanalyzer
+ *
+ * <refsect2>
+ * Detects pitch, beats and onsets along an audio stream, computing a
+ * single phase vocoder per hop for all of them
+ * <title>Example launch line</title>
+ * <para>
+ * <programlisting>
+ * gst-launch-1.0 -v -m audiotestsrc ! aubioanalyzer ! fakesink
+ * gst-launch-1.0 filesrc location=audiofile ! decodebin ! \
+ *      aubioanalyzer detectors=pitch+tempo silent=FALSE ! autoaudiosink
+ * </programlisting>
+ * </para>
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* the spectral pitch detector and the beat tracker are only exposed by
+ * aubio's unstable API */
+#define AUBIO_UNSTABLE 1
+
+#include <math.h>
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#include "gstaubioanalyzer.h"
+
+GST_DEBUG_CATEGORY_STATIC(aubioanalyzer_debug);
+#define GST_CAT_DEFAULT aubioanalyzer_debug
+
+enum
+{
+  SIGNAL_PULL_RESULTS,
+  LAST_SIGNAL
+};
+
+enum
+{
+  PROP_0,
+  PROP_SILENT,
+  PROP_MESSAGE,
+  PROP_DOWNMIX,
+  PROP_DETECTORS,
+  PROP_ONSET_METHOD,
+  PROP_RING_SIZE
+};
+
+/* window and hop sizes at GST_AUBIO_REFERENCE_RATE, scaled to the
+ * negotiated rate in setup */
+#define DEFAULT_BUF_SIZE 1024
+#define DEFAULT_HOP_SIZE 128
+
+#define DEFAULT_DETECTORS (GST_AUBIO_DETECT_PITCH | GST_AUBIO_DETECT_TEMPO)
+#define DEFAULT_ONSET_METHOD "kl"
+#define DEFAULT_RING_SIZE 0
+
+/* same settings as aubio_tempo */
+#define PEAKPICK_THRESHOLD 0.3
+#define SILENCE_THRESHOLD -90.
+/* delay of the peak picker, in hops */
+#define ONSET_DELAY 4.3
+
+#define ALLOWED_CAPS                                                  \
+    GST_AUDIO_CAPS_MAKE ("{ " GST_AUDIO_NE (F32) ", "                 \
+        GST_AUDIO_NE (F64) ", " GST_AUDIO_NE (S16) ", "               \
+        GST_AUDIO_NE (S32) " }")                                      \
+    ", layout=(string)interleaved"
+
+/* state of the detectors of one analysed channel */
+struct _GstAubioAnalyzerChannel
+{
+  /* shared front end */
+  aubio_pvoc_t * pv;
+  cvec_t * fftgrain;
+
+  /* pitch */
+  aubio_pitchmcomb_t * pitch;
+  fvec_t * pitch_out;
+
+  /* onset detection function, shared by onsets and beats */
+  aubio_specdesc_t * od;
+  fvec_t * odf;
+  aubio_peakpicker_t * pp;
+  fvec_t * onset;
+
+  /* beats, as in aubio_tempo_do */
+  aubio_beattracking_t * bt;
+  fvec_t * dfframe;
+  fvec_t * bt_out;
+  uint winlen;
+  uint step;
+  signed int blockpos;
+};
+
+static GstStaticPadTemplate results_template =
+GST_STATIC_PAD_TEMPLATE ("results",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("application/x-aubio-analyzer"));
+
+#define gst_aubio_analyzer_parent_class parent_class
+G_DEFINE_TYPE (GstAubioAnalyzer, gst_aubio_analyzer, GST_TYPE_AUDIO_FILTER);
+
+static guint gst_aubio_analyzer_signals[LAST_SIGNAL] = { 0 };
+
+static void gst_aubio_analyzer_finalize (GObject * obj);
+static void gst_aubio_analyzer_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_aubio_analyzer_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static GstBuffer *gst_aubio_analyzer_pull_results (GstAubioAnalyzer * filter);
+
+static gboolean gst_aubio_analyzer_setup (GstAudioFilter * audiofilter,
+        const GstAudioInfo * info);
+static gboolean gst_aubio_analyzer_sink_event (GstBaseTransform * trans,
+        GstEvent * event);
+static GstFlowReturn gst_aubio_analyzer_transform_ip (GstBaseTransform * trans,
+        GstBuffer * buf);
+
+static GstPad *gst_aubio_analyzer_request_new_pad (GstElement * element,
+        GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_aubio_analyzer_release_pad (GstElement * element,
+        GstPad * pad);
+
+GType
+gst_aubio_detectors_get_type (void)
+{
+  static volatile gsize type = 0;
+  static const GFlagsValue values[] = {
+    {GST_AUBIO_DETECT_PITCH, "Pitch", "pitch"},
+    {GST_AUBIO_DETECT_TEMPO, "Beats and tempo", "tempo"},
+    {GST_AUBIO_DETECT_ONSET, "Onsets", "onset"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_flags_register_static ("GstAubioDetectors", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+/* GObject vmethod implementations */
+/* initialize the plugin's class */
+static void
+gst_aubio_analyzer_class_init (GstAubioAnalyzerClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+  GstAudioFilterClass *filter_class = GST_AUDIO_FILTER_CLASS (klass);
+  GstCaps *caps;
+
+  caps = gst_caps_from_string (ALLOWED_CAPS);
+  gst_audio_filter_class_add_pad_templates (filter_class, caps);
+  gst_caps_unref (caps);
+
+  gst_element_class_add_static_pad_template (element_class,
+      &results_template);
+
+  gst_element_class_set_static_metadata (element_class,
+      "Aubio Analysis",
+      "Filter/Analyzer/Audio",
+      "Extract pitch, beats and onsets from a single spectral analysis",
+      "Paul Brossier <piem@aubio.org>");
+
+  filter_class->setup = GST_DEBUG_FUNCPTR (gst_aubio_analyzer_setup);
+
+  trans_class->sink_event =
+      GST_DEBUG_FUNCPTR (gst_aubio_analyzer_sink_event);
+  trans_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_aubio_analyzer_transform_ip);
+  trans_class->passthrough_on_same_caps = TRUE;
+
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_aubio_analyzer_request_new_pad);
+  element_class->release_pad =
+      GST_DEBUG_FUNCPTR (gst_aubio_analyzer_release_pad);
+
+  gobject_class->finalize = gst_aubio_analyzer_finalize;
+  gobject_class->set_property = gst_aubio_analyzer_set_property;
+  gobject_class->get_property = gst_aubio_analyzer_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_SILENT,
+      g_param_spec_boolean ("silent", "Silent", "Produce verbose output",
+          TRUE, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_MESSAGE,
+      g_param_spec_boolean ("message", "Message",
+          "Emit gstreamer messages for beats and onsets",
+          TRUE, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_DOWNMIX,
+      g_param_spec_boolean ("downmix", "Downmix",
+          "Analyse the average of all channels instead of each channel",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_DETECTORS,
+      g_param_spec_flags ("detectors", "Detectors",
+          "Detectors to run on the shared spectral analysis",
+          GST_TYPE_AUBIO_DETECTORS, DEFAULT_DETECTORS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_ONSET_METHOD,
+      g_param_spec_string ("onset-method", "Onset method",
+          "Spectral descriptor used to detect onsets and track beats",
+          DEFAULT_ONSET_METHOD, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring size",
+          "Number of results kept for the pull-results action signal, "
+          "rounded up to a power of two, newer results are dropped when "
+          "it is full (0 = no ring)", 0, GST_AUBIO_RING_MAX_SIZE,
+          DEFAULT_RING_SIZE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstAubioAnalyzer::pull-results:
+   *
+   * Takes all the results kept since the last call, as a buffer of packed
+   * GstAubioResult records in the order they were found, or NULL when
+   * there are none. Can be emitted from any thread, needs ring-size.
+   */
+  gst_aubio_analyzer_signals[SIGNAL_PULL_RESULTS] =
+      g_signal_new ("pull-results", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstAubioAnalyzerClass, pull_results), NULL, NULL, NULL,
+      GST_TYPE_BUFFER, 0, G_TYPE_NONE);
+
+  klass->pull_results = gst_aubio_analyzer_pull_results;
+
+  GST_DEBUG_CATEGORY_INIT (aubioanalyzer_debug, "aubioanalyzer", 0,
+          "Aubio combined analysis");
+
+}
+
+static void
+gst_aubio_analyzer_init (GstAubioAnalyzer * filter)
+{
+
+  filter->silent = TRUE;
+  filter->message = TRUE;
+  filter->downmix = FALSE;
+  filter->detectors = DEFAULT_DETECTORS;
+  filter->onset_method = g_strdup (DEFAULT_ONSET_METHOD);
+
+  filter->buf_size = DEFAULT_BUF_SIZE;
+  filter->hop_size = DEFAULT_HOP_SIZE;
+  filter->samplerate = GST_AUBIO_REFERENCE_RATE;
+
+  filter->resync = TRUE;
+  filter->fresh = FALSE;
+  filter->start_time = 0;
+  filter->frames = 0;
+
+  filter->ring_size = DEFAULT_RING_SIZE;
+  gst_aubio_ring_init (&filter->ring);
+
+  /* detectors are created in setup, once the channel count is known */
+  filter->channels = 0;
+  filter->chan = NULL;
+  filter->ibuf = NULL;
+}
+
+static void
+gst_aubio_analyzer_free_channel (GstAubioAnalyzerChannel * ch)
+{
+  if (ch->pv)
+    del_aubio_pvoc (ch->pv);
+  if (ch->fftgrain)
+    del_cvec (ch->fftgrain);
+  if (ch->pitch)
+    del_aubio_pitchmcomb (ch->pitch);
+  if (ch->pitch_out)
+    del_fvec (ch->pitch_out);
+  if (ch->od)
+    del_aubio_specdesc (ch->od);
+  if (ch->odf)
+    del_fvec (ch->odf);
+  if (ch->pp)
+    del_aubio_peakpicker (ch->pp);
+  if (ch->onset)
+    del_fvec (ch->onset);
+  if (ch->bt)
+    del_aubio_beattracking (ch->bt);
+  if (ch->dfframe)
+    del_fvec (ch->dfframe);
+  if (ch->bt_out)
+    del_fvec (ch->bt_out);
+}
+
+static void
+gst_aubio_analyzer_free_analysers (GstAubioAnalyzer * filter)
+{
+  uint i;
+
+  for (i = 0; i < filter->channels; i++) {
+    gst_aubio_analyzer_free_channel (&filter->chan[i]);
+    if (filter->ibuf[i]) {
+      del_fvec(filter->ibuf[i]);
+    }
+  }
+  g_free (filter->chan);
+  g_free (filter->ibuf);
+
+  filter->chan = NULL;
+  filter->ibuf = NULL;
+  filter->channels = 0;
+}
+
+static gboolean
+gst_aubio_analyzer_new_channel (GstAubioAnalyzer * filter,
+    GstAubioAnalyzerChannel * ch)
+{
+  ch->pv = new_aubio_pvoc (filter->buf_size, filter->hop_size);
+  ch->fftgrain = new_cvec (filter->buf_size);
+  if (ch->pv == NULL)
+    return FALSE;
+
+  if (filter->detectors & GST_AUBIO_DETECT_PITCH) {
+    ch->pitch = new_aubio_pitchmcomb (filter->buf_size, filter->hop_size);
+    ch->pitch_out = new_fvec (1);
+    if (ch->pitch == NULL)
+      return FALSE;
+  }
+
+  if (filter->detectors & (GST_AUBIO_DETECT_TEMPO | GST_AUBIO_DETECT_ONSET)) {
+    ch->od = new_aubio_specdesc (filter->onset_method, filter->buf_size);
+    ch->odf = new_fvec (1);
+    ch->pp = new_aubio_peakpicker ();
+    ch->onset = new_fvec (1);
+    if (ch->od == NULL || ch->pp == NULL)
+      return FALSE;
+    aubio_peakpicker_set_threshold (ch->pp, PEAKPICK_THRESHOLD);
+  }
+
+  if (filter->detectors & GST_AUBIO_DETECT_TEMPO) {
+    /* about 6 seconds of onset detection function */
+    ch->winlen = 4;
+    while (ch->winlen < 5.8 * filter->samplerate / filter->hop_size)
+      ch->winlen <<= 1;
+    ch->step = ch->winlen / 4;
+    ch->blockpos = 0;
+    ch->dfframe = new_fvec (ch->winlen);
+    ch->bt_out = new_fvec (ch->step);
+    ch->bt = new_aubio_beattracking (ch->winlen, filter->hop_size,
+        filter->samplerate);
+    if (ch->bt == NULL)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* forget the stream analysed so far, after a flush, a new segment or a
+ * discontinuity */
+static void
+gst_aubio_analyzer_reset (GstAubioAnalyzer * filter)
+{
+  uint i;
+
+  filter->resync = TRUE;
+  filter->pos = 0;
+
+  /* nothing to forget yet, as on the segment that follows the caps */
+  if (filter->fresh)
+    return;
+
+  /* aubio has no way to clear a detector, start over with new ones */
+  for (i = 0; i < filter->channels; i++) {
+    gst_aubio_analyzer_free_channel (&filter->chan[i]);
+    memset (&filter->chan[i], 0, sizeof (GstAubioAnalyzerChannel));
+    if (!gst_aubio_analyzer_new_channel (filter, &filter->chan[i])) {
+      GST_ERROR_OBJECT (filter, "could not create detectors");
+      gst_aubio_analyzer_free_analysers (filter);
+      return;
+    }
+  }
+  filter->fresh = TRUE;
+}
+
+static gboolean
+gst_aubio_analyzer_setup (GstAudioFilter * audiofilter,
+    const GstAudioInfo * info)
+{
+  GstAubioAnalyzer *filter = GST_AUBIO_ANALYZER (audiofilter);
+  GstClockTime hop, latency;
+  uint i;
+
+  gst_aubio_analyzer_free_analysers (filter);
+
+  if (!gst_aubio_format_from_info (info, &filter->sample_format)) {
+    GST_ERROR_OBJECT (filter, "unsupported sample format");
+    return FALSE;
+  }
+
+  filter->samplerate = GST_AUDIO_INFO_RATE (info);
+  filter->buf_size = gst_aubio_scale_size (DEFAULT_BUF_SIZE,
+      filter->samplerate);
+  filter->hop_size = gst_aubio_scale_size (DEFAULT_HOP_SIZE,
+      filter->samplerate);
+
+  /* one set of detectors per channel, or one on the downmixed signal */
+  filter->channels = filter->downmix ? 1 : GST_AUDIO_INFO_CHANNELS (info);
+  filter->chan = g_new0 (GstAubioAnalyzerChannel, filter->channels);
+  filter->ibuf = g_new0 (fvec_t *, filter->channels);
+  filter->pos = 0;
+  filter->resync = TRUE;
+  filter->fresh = TRUE;
+
+  for (i = 0; i < filter->channels; i++) {
+    filter->ibuf[i] = new_fvec(filter->hop_size);
+    if (!gst_aubio_analyzer_new_channel (filter, &filter->chan[i])) {
+      GST_ERROR_OBJECT (filter, "could not create detectors");
+      gst_aubio_analyzer_free_analysers (filter);
+      return FALSE;
+    }
+  }
+
+  /* the largest delay of a result: half a window for the pitch, the
+   * look-ahead of the peak picker for onsets, two hops for beats */
+  hop = GST_FRAMES_TO_CLOCK_TIME (filter->hop_size, filter->samplerate);
+  latency = GST_FRAMES_TO_CLOCK_TIME (filter->buf_size / 2,
+      filter->samplerate);
+  latency = MAX (latency, (GstClockTime) ((ONSET_DELAY + 1.) * hop));
+  latency = MAX (latency, 2 * hop);
+  gst_aubio_results_pad_set_latency (&filter->results, GST_ELEMENT (filter),
+      latency);
+
+  GST_DEBUG_OBJECT (filter, "analysing %u of %d channels at %d Hz, "
+      "buf_size %u, hop_size %u, latency %" GST_TIME_FORMAT, filter->channels,
+      GST_AUDIO_INFO_CHANNELS (info), filter->samplerate, filter->buf_size,
+      filter->hop_size, GST_TIME_ARGS (latency));
+
+  return TRUE;
+}
+
+static void
+gst_aubio_analyzer_finalize (GObject * obj)
+{
+  GstAubioAnalyzer * filter = GST_AUBIO_ANALYZER (obj);
+
+  gst_aubio_analyzer_free_analysers (filter);
+  g_free (filter->onset_method);
+  gst_aubio_ring_clear (&filter->ring);
+
+  G_OBJECT_CLASS (parent_class)->finalize (obj);
+}
+
+static void
+gst_aubio_analyzer_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstAubioAnalyzer *filter = GST_AUBIO_ANALYZER (object);
+
+  switch (prop_id) {
+    case PROP_SILENT:
+      filter->silent = g_value_get_boolean (value);
+      break;
+    case PROP_MESSAGE:
+      filter->message = g_value_get_boolean (value);
+      break;
+    case PROP_DOWNMIX:
+      filter->downmix = g_value_get_boolean (value);
+      break;
+    case PROP_DETECTORS:
+      filter->detectors = g_value_get_flags (value);
+      break;
+    case PROP_ONSET_METHOD:
+      g_free (filter->onset_method);
+      filter->onset_method = g_value_dup_string (value);
+      break;
+    case PROP_RING_SIZE:
+      /* the ring is written without a lock while streaming */
+      if (gst_aubio_ring_configure (&filter->ring, GST_ELEMENT (filter),
+              g_value_get_uint (value)))
+        filter->ring_size = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_aubio_analyzer_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstAubioAnalyzer *filter = GST_AUBIO_ANALYZER (object);
+
+  switch (prop_id) {
+    case PROP_SILENT:
+      g_value_set_boolean (value, filter->silent);
+      break;
+    case PROP_MESSAGE:
+      g_value_set_boolean (value, filter->message);
+      break;
+    case PROP_DOWNMIX:
+      g_value_set_boolean (value, filter->downmix);
+      break;
+    case PROP_DETECTORS:
+      g_value_set_flags (value, filter->detectors);
+      break;
+    case PROP_ONSET_METHOD:
+      g_value_set_string (value, filter->onset_method);
+      break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, filter->ring_size);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static GstBuffer *
+gst_aubio_analyzer_pull_results (GstAubioAnalyzer * filter)
+{
+  return gst_aubio_ring_pull (&filter->ring, GST_OBJECT (filter));
+}
+
+static const gchar *
+gst_aubio_analyzer_kind_name (GstAubioResultKind kind)
+{
+  switch (kind) {
+    case GST_AUBIO_RESULT_PITCH:
+      return "pitch";
+    case GST_AUBIO_RESULT_BEAT:
+      return "beat";
+    default:
+      return "onset";
+  }
+}
+
+/* report one result on every enabled output */
+static void
+gst_aubio_analyzer_report (GstAubioAnalyzer * filter, GstAubioResultKind kind,
+    uint channel, GstClockTime when, GstClockTime end, gfloat value,
+    gfloat confidence)
+{
+  GstAubioResult r;
+
+  r.timestamp = when;
+  r.value = value;
+  r.confidence = confidence;
+  r.channel = channel;
+  r.kind = kind;
+  r.emitted = end;
+  gst_aubio_results_pad_append (&filter->results, &r);
+  gst_aubio_ring_push (&filter->ring, &r);
+
+  if (filter->silent == FALSE) {
+    g_print ("%" GST_TIME_FORMAT "\tchannel: %u\t%s: %.3f\n",
+        GST_TIME_ARGS (when), channel, gst_aubio_analyzer_kind_name (kind),
+        value);
+  }
+
+  GST_LOG_OBJECT (filter, "%s %" GST_TIME_FORMAT ", channel %u, value %3.2f",
+      gst_aubio_analyzer_kind_name (kind), GST_TIME_ARGS (when), channel,
+      value);
+
+  /* pitch comes every hop, only post the sparse events */
+  if (filter->message && kind != GST_AUBIO_RESULT_PITCH) {
+    GstStructure *s;
+
+    s = gst_structure_new ("aubioanalyzer",
+        "kind"      , G_TYPE_STRING      , gst_aubio_analyzer_kind_name (kind),
+        "timestamp" , GST_TYPE_CLOCK_TIME, when,
+        "channel"   , G_TYPE_UINT        , channel,
+        "value"     , G_TYPE_DOUBLE      , (gdouble) value,
+        "confidence", G_TYPE_DOUBLE      , (gdouble) confidence,
+        NULL);
+    gst_element_post_message (GST_ELEMENT (filter),
+        gst_message_new_element (GST_OBJECT (filter), s));
+  }
+}
+
+/* second level of aubio_tempo_do: feed the beat tracker with the
+ * thresholded onset detection function and report predicted beats */
+static void
+gst_aubio_analyzer_track_beats (GstAubioAnalyzer * filter, uint channel,
+    const fvec_t * in, GstClockTime start, GstClockTime duration,
+    GstClockTime end)
+{
+  GstAubioAnalyzerChannel *ch = &filter->chan[channel];
+  fvec_t *thresholded;
+  uint i;
+
+  if (ch->blockpos == (signed) ch->step - 1) {
+    aubio_beattracking_do (ch->bt, ch->dfframe, ch->bt_out);
+    /* rotate dfframe */
+    for (i = 0; i < ch->winlen - ch->step; i++)
+      ch->dfframe->data[i] = ch->dfframe->data[i + ch->step];
+    for (i = ch->winlen - ch->step; i < ch->winlen; i++)
+      ch->dfframe->data[i] = 0.;
+    ch->blockpos = -1;
+  }
+  ch->blockpos++;
+
+  thresholded = aubio_peakpicker_get_thresholded_input (ch->pp);
+  ch->dfframe->data[ch->winlen - ch->step + ch->blockpos] =
+      thresholded->data[0];
+
+  for (i = 1; i < ch->bt_out->data[0]; i++) {
+    /* if current frame is a predicted tactus */
+    if (ch->blockpos == (signed) floor (ch->bt_out->data[i])
+        && aubio_silence_detection (in, SILENCE_THRESHOLD) == 0) {
+      smpl_t frac = ch->bt_out->data[i] - floor (ch->bt_out->data[i]);
+      /* placed as aubiotempo does, (frac - 1) hops after the hop start */
+      GstClockTime when = start + (GstClockTime) (frac * duration);
+
+      gst_aubio_analyzer_report (filter, GST_AUBIO_RESULT_BEAT, channel,
+          when > duration ? when - duration : 0, end,
+          aubio_beattracking_get_bpm (ch->bt),
+          aubio_beattracking_get_confidence (ch->bt));
+    }
+  }
+}
+
+static void
+gst_aubio_analyzer_process_hop (GstAubioAnalyzer * filter, uint channel,
+    const fvec_t * in, GstClockTime end)
+{
+  GstAubioAnalyzerChannel *ch = &filter->chan[channel];
+  GstClockTime duration, start;
+
+  duration = GST_FRAMES_TO_CLOCK_TIME (filter->hop_size, filter->samplerate);
+  start = end - GST_FRAMES_TO_CLOCK_TIME (filter->hop_size - 1,
+      filter->samplerate);
+  if (end < start)
+    start = 0;
+
+  /* the one windowed FFT of this hop, shared by all detectors */
+  aubio_pvoc_do (ch->pv, in, ch->fftgrain);
+
+  if (filter->detectors & GST_AUBIO_DETECT_PITCH) {
+    /* as in aubiopitch, the pitch is that of the middle of the window */
+    GstClockTime delay = GST_FRAMES_TO_CLOCK_TIME (filter->buf_size / 2,
+        filter->samplerate);
+
+    /* the multi-comb detector has no confidence measure, reported as 0 */
+    aubio_pitchmcomb_do (ch->pitch, ch->fftgrain, ch->pitch_out);
+    gst_aubio_analyzer_report (filter, GST_AUBIO_RESULT_PITCH, channel,
+        end > delay ? end - delay : 0, end, aubio_bintofreq (ch->pitch_out->data[0], filter->samplerate,
+            filter->buf_size), 0.);
+  }
+
+  if (ch->od == NULL)
+    return;
+
+  aubio_specdesc_do (ch->od, ch->fftgrain, ch->odf);
+  aubio_peakpicker_do (ch->pp, ch->odf, ch->onset);
+
+  if ((filter->detectors & GST_AUBIO_DETECT_ONSET)
+      && ch->onset->data[0] > 0.
+      && aubio_silence_detection (in, SILENCE_THRESHOLD) == 0) {
+    /* the peak picker looks a few hops ahead */
+    GstClockTime delay = ONSET_DELAY * duration;
+    GstClockTime when = start + ch->onset->data[0] * duration;
+
+    gst_aubio_analyzer_report (filter, GST_AUBIO_RESULT_ONSET, channel,
+        when > delay ? when - delay : 0, end, ch->onset->data[0], 0.);
+  }
+
+  if (filter->detectors & GST_AUBIO_DETECT_TEMPO) {
+    gst_aubio_analyzer_track_beats (filter, channel, in, start, duration,
+        end);
+  }
+}
+
+static gboolean
+gst_aubio_analyzer_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstAubioAnalyzer *filter = GST_AUBIO_ANALYZER (trans);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+    case GST_EVENT_SEGMENT:
+      gst_aubio_analyzer_reset (filter);
+      break;
+    default:
+      break;
+  }
+
+  gst_aubio_results_pad_event (&filter->results, GST_ELEMENT (filter), event);
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+static GstFlowReturn
+gst_aubio_analyzer_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
+{
+  guint j, len;
+  uint c;
+  GstAubioAnalyzer *filter = GST_AUBIO_ANALYZER (trans);
+  GstAudioFilter *audiofilter = GST_AUDIO_FILTER(trans);
+  guint channels = GST_AUDIO_FILTER_CHANNELS (audiofilter);
+  guint bpf = GST_AUDIO_FILTER_BPF (audiofilter);
+  GstClockTime now;
+  fvec_t view, *viewp = &view, **hops;
+  GstMapInfo map;
+  guint8 *data;
+  guint nsamples;
+
+  if (G_UNLIKELY (filter->chan == NULL))
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  if (GST_BUFFER_IS_DISCONT (buf) && !filter->resync) {
+    GST_DEBUG_OBJECT (filter, "discontinuity, dropping %u frames", filter->pos);
+    gst_aubio_analyzer_reset (filter);
+    if (G_UNLIKELY (filter->chan == NULL))
+      return GST_FLOW_ERROR;
+  }
+  if (filter->resync) {
+    filter->start_time = GST_BUFFER_PTS_IS_VALID (buf) ?
+        GST_BUFFER_PTS (buf) : 0;
+    filter->frames = 0;
+    filter->resync = FALSE;
+  }
+
+  /* the samples are only read, mapping never copies them */
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+  data = map.data;
+  nsamples = map.size / bpf;
+
+  /* at most a pitch, a beat and an onset per hop and channel */
+  gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+      (filter->pos + nsamples) / filter->hop_size * filter->channels * 3);
+
+  /* hop loop, runs once per hop */
+  for (j = 0; j < nsamples; j += len) {
+    if (channels == 1 && filter->sample_format == GST_AUBIO_FORMAT_NATIVE
+        && filter->pos == 0 && nsamples - j >= filter->hop_size) {
+      /* a full hop is available in place, analyse it without copying */
+      len = filter->hop_size;
+      view.length = len;
+      view.data = (smpl_t *) (data + j * bpf);
+      hops = &viewp;
+    } else {
+      /* convert and deinterleave as much input as fits to the channel
+       * ibufs */
+      len = MIN (filter->hop_size - filter->pos, nsamples - j);
+      gst_aubio_deinterleave (filter->ibuf, filter->pos, data + j * bpf,
+          filter->sample_format, channels, len, filter->downmix);
+      filter->pos += len;
+
+      if (filter->pos < filter->hop_size)
+        continue;
+      filter->pos = 0;
+      hops = filter->ibuf;
+    }
+
+    now = filter->start_time;
+    // correction of inside buffer time
+    now += GST_FRAMES_TO_CLOCK_TIME(filter->frames + j + len - 1,
+        GST_AUDIO_FILTER_RATE (audiofilter));
+
+    for (c = 0; c < filter->channels; c++) {
+      gst_aubio_analyzer_process_hop (filter, c, hops[c], now);
+    }
+  }
+
+  filter->frames += nsamples;
+  filter->fresh = FALSE;
+  gst_buffer_unmap (buf, &map);
+  gst_aubio_results_pad_finish (&filter->results, &trans->segment);
+
+  return GST_FLOW_OK;
+}
+
+static GstPad *
+gst_aubio_analyzer_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstAubioAnalyzer *filter = GST_AUBIO_ANALYZER (element);
+
+  return gst_aubio_results_pad_request (&filter->results, element, templ,
+      "application/x-aubio-analyzer");
+}
+
+static void
+gst_aubio_analyzer_release_pad (GstElement * element, GstPad * pad)
+{
+  GstAubioAnalyzer *filter = GST_AUBIO_ANALYZER (element);
+
+  gst_aubio_results_pad_release (&filter->results, element, pad);
+}
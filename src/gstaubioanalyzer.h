@@ -0,0 +1,109 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __GST_AUBIO_ANALYZER_H__
+#define __GST_AUBIO_ANALYZER_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/audio/gstaudiofilter.h>
+
+#include <aubio/aubio.h>
+
+#include "gstaubioutils.h"
+#include "gstaubioresults.h"
+#include "gstaubioring.h"
+
+G_BEGIN_DECLS
+
+/* #defines don't like whitespacey bits */
+#define GST_TYPE_AUBIO_ANALYZER \
+  (gst_aubio_analyzer_get_type())
+#define GST_AUBIO_ANALYZER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_AUBIO_ANALYZER,GstAubioAnalyzer))
+#define GST_IS_AUBIO_ANALYZER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_AUBIO_ANALYZER))
+#define GST_AUBIO_ANALYZER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_AUBIO_ANALYZER,GstAubioAnalyzerClass))
+#define GST_IS_AUBIO_ANALYZER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_AUBIO_ANALYZER))
+#define GST_AUBIO_ANALYZER_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_AUBIO_ANALYZER, GstAubioAnalyzerClass))
+
+typedef enum
+{
+  GST_AUBIO_DETECT_PITCH = (1 << 0),
+  GST_AUBIO_DETECT_TEMPO = (1 << 1),
+  GST_AUBIO_DETECT_ONSET = (1 << 2)
+} GstAubioDetectors;
+
+#define GST_TYPE_AUBIO_DETECTORS (gst_aubio_detectors_get_type ())
+GType gst_aubio_detectors_get_type (void);
+
+typedef struct _GstAubioAnalyzer        GstAubioAnalyzer;
+typedef struct _GstAubioAnalyzerClass   GstAubioAnalyzerClass;
+typedef struct _GstAubioAnalyzerChannel GstAubioAnalyzerChannel;
+
+struct _GstAubioAnalyzer
+{
+  GstAudioFilter element;
+
+  gboolean silent;
+  gboolean message;
+  gboolean downmix;
+  GstAubioDetectors detectors;
+  gchar * onset_method;
+
+  GstAubioAnalyzerChannel * chan;   /* one per analysed channel */
+  fvec_t ** ibuf;                   /* one hop vector per analysed channel */
+
+  GstAubioFormat sample_format;
+  uint buf_size;
+  uint hop_size;
+  uint channels;        /* number of analysed channels */
+  uint samplerate;
+  uint pos;
+
+  /* running sample counter the hops are timed with */
+  gboolean resync;      /* take the time of the next buffer */
+  gboolean fresh;       /* no audio analysed since the detectors were built */
+  GstClockTime start_time;      /* time of the first frame counted */
+  guint64 frames;       /* frames received since then */
+
+  GstAubioResultsPad results;
+
+  guint ring_size;
+  GstAubioRing ring;    /* results for pull-results */
+};
+
+struct _GstAubioAnalyzerClass 
+{
+  GstAudioFilterClass parent_class;
+
+  /* actions */
+  GstBuffer * (*pull_results) (GstAubioAnalyzer * filter);
+};
+
+GType gst_aubio_analyzer_get_type (void);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_ANALYZER_H__ */
@@ -0,0 +1,646 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/**
+ * SECTION:element-aubiobatchsrc
+ *
+ * Analyses a whole file with several pipelines at once. The file is split
+ * into as many segments as there are processors, each one decoded and
+ * analysed by a pipeline of its own, starting a little before the segment
+ * so that the detectors have warmed up when it begins and ending a little
+ * after so that late results are still seen. The results of each segment
+ * are then pushed in order, as buffers of GstAubioResult records like the
+ * ones of the results pad of the analysis element.
+ *
+ * Streams that cannot be seeked, live ones or ones of unknown duration
+ * are analysed in a single segment.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 -m aubiobatchsrc uri=file:///path/to/audiofile \
+ *     analysis="aubiotempo" ! filesink location=beats.bin
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include <gst/gst.h>
+
+#include "gstaubiobatchsrc.h"
+
+GST_DEBUG_CATEGORY_STATIC(aubiobatchsrc_debug);
+#define GST_CAT_DEFAULT aubiobatchsrc_debug
+
+enum
+{
+  PROP_0,
+  PROP_URI,
+  PROP_ANALYSIS,
+  PROP_SEGMENTS,
+  PROP_OVERLAP
+};
+
+#define DEFAULT_ANALYSIS "aubiotempo"
+#define DEFAULT_SEGMENTS 0
+/* long enough for the beat tracker to lock on */
+#define DEFAULT_OVERLAP (10 * GST_SECOND)
+
+/* how often a wait for a segment checks for unlock */
+#define POLL_INTERVAL (100 * GST_MSECOND)
+
+static GstStaticPadTemplate src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-aubio-pitch; "
+        "application/x-aubio-tempo; "
+        "application/x-aubio-analyzer"));
+
+#define gst_aubio_batch_src_parent_class parent_class
+G_DEFINE_TYPE (GstAubioBatchSrc, gst_aubio_batch_src, GST_TYPE_BASE_SRC);
+
+static void gst_aubio_batch_src_finalize (GObject * obj);
+static void gst_aubio_batch_src_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_aubio_batch_src_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+
+static gboolean gst_aubio_batch_src_start (GstBaseSrc * basesrc);
+static gboolean gst_aubio_batch_src_stop (GstBaseSrc * basesrc);
+static gboolean gst_aubio_batch_src_negotiate (GstBaseSrc * basesrc);
+static gboolean gst_aubio_batch_src_is_seekable (GstBaseSrc * basesrc);
+static gboolean gst_aubio_batch_src_unlock (GstBaseSrc * basesrc);
+static gboolean gst_aubio_batch_src_unlock_stop (GstBaseSrc * basesrc);
+static GstFlowReturn gst_aubio_batch_src_create (GstBaseSrc * basesrc,
+    guint64 offset, guint size, GstBuffer ** buf);
+
+/* GObject vmethod implementations */
+/* initialize the plugin's class */
+static void
+gst_aubio_batch_src_class_init (GstAubioBatchSrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSrcClass *basesrc_class = GST_BASE_SRC_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+
+  gst_element_class_set_static_metadata (element_class,
+      "Aubio Batch Analysis",
+      "Source/Analyzer/Audio",
+      "Analyse segments of a file in parallel using aubio",
+      "Paul Brossier <piem@aubio.org>");
+
+  basesrc_class->start = GST_DEBUG_FUNCPTR (gst_aubio_batch_src_start);
+  basesrc_class->stop = GST_DEBUG_FUNCPTR (gst_aubio_batch_src_stop);
+  basesrc_class->negotiate = GST_DEBUG_FUNCPTR (gst_aubio_batch_src_negotiate);
+  basesrc_class->is_seekable =
+      GST_DEBUG_FUNCPTR (gst_aubio_batch_src_is_seekable);
+  basesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_aubio_batch_src_unlock);
+  basesrc_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_aubio_batch_src_unlock_stop);
+  basesrc_class->create = GST_DEBUG_FUNCPTR (gst_aubio_batch_src_create);
+
+  gobject_class->finalize = gst_aubio_batch_src_finalize;
+  gobject_class->set_property = gst_aubio_batch_src_set_property;
+  gobject_class->get_property = gst_aubio_batch_src_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_URI,
+      g_param_spec_string ("uri", "URI", "URI of the file to analyse",
+          NULL, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_ANALYSIS,
+      g_param_spec_string ("analysis", "Analysis",
+          "Analysis element and its properties, in gst-launch syntax, "
+          "such as \"aubiopitch method=yin\"",
+          DEFAULT_ANALYSIS, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_SEGMENTS,
+      g_param_spec_uint ("segments", "Segments",
+          "Number of segments analysed in parallel "
+          "(0 = one per processor)",
+          0, G_MAXUINT, DEFAULT_SEGMENTS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_OVERLAP,
+      g_param_spec_uint64 ("overlap", "Overlap",
+          "Nanoseconds of audio analysed before and after each segment",
+          0, G_MAXUINT64, DEFAULT_OVERLAP,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  GST_DEBUG_CATEGORY_INIT (aubiobatchsrc_debug, "aubiobatchsrc", 0,
+          "Aubio parallel offline analysis");
+}
+
+static void
+gst_aubio_batch_src_init (GstAubioBatchSrc * src)
+{
+  src->uri = NULL;
+  src->analysis = g_strdup (DEFAULT_ANALYSIS);
+  src->segments = DEFAULT_SEGMENTS;
+  src->overlap = DEFAULT_OVERLAP;
+
+  src->caps = NULL;
+  src->jobs = NULL;
+  src->n_jobs = 0;
+  src->next = 0;
+  src->flushing = FALSE;
+
+  gst_base_src_set_format (GST_BASE_SRC (src), GST_FORMAT_TIME);
+}
+
+static void
+gst_aubio_batch_src_finalize (GObject * obj)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (obj);
+
+  g_free (src->uri);
+  g_free (src->analysis);
+
+  G_OBJECT_CLASS (parent_class)->finalize (obj);
+}
+
+static void
+gst_aubio_batch_src_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (object);
+
+  switch (prop_id) {
+    case PROP_URI:
+      GST_OBJECT_LOCK (src);
+      g_free (src->uri);
+      src->uri = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_ANALYSIS:
+      GST_OBJECT_LOCK (src);
+      g_free (src->analysis);
+      src->analysis = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_SEGMENTS:
+      GST_OBJECT_LOCK (src);
+      src->segments = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_OVERLAP:
+      GST_OBJECT_LOCK (src);
+      src->overlap = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_aubio_batch_src_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (object);
+
+  switch (prop_id) {
+    case PROP_URI:
+      GST_OBJECT_LOCK (src);
+      g_value_set_string (value, src->uri);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_ANALYSIS:
+      GST_OBJECT_LOCK (src);
+      g_value_set_string (value, src->analysis);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_SEGMENTS:
+      GST_OBJECT_LOCK (src);
+      g_value_set_uint (value, src->segments);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case PROP_OVERLAP:
+      GST_OBJECT_LOCK (src);
+      g_value_set_uint64 (value, src->overlap);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/* collects the results reaching the results sink of a job */
+static GstPadProbeReturn
+gst_aubio_batch_src_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstAubioBatchJob *job = user_data;
+  GstMapInfo map;
+
+  if (gst_buffer_map (GST_PAD_PROBE_INFO_BUFFER (info), &map, GST_MAP_READ)) {
+    g_array_append_vals (job->results, map.data,
+        map.size / sizeof (GstAubioResult));
+    gst_buffer_unmap (GST_PAD_PROBE_INFO_BUFFER (info), &map);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+/* forgets the results of the preroll once the job seeks to its segment */
+static GstPadProbeReturn
+gst_aubio_batch_src_event_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstAubioBatchJob *job = user_data;
+
+  if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_FLUSH_STOP)
+    g_array_set_size (job->results, 0);
+  return GST_PAD_PROBE_OK;
+}
+
+/* build the pipeline of a job: the file is decoded and analysed, the
+ * audio and the results are then dropped on fakesinks, the results after
+ * going through the probes. Only the audio sink prerolls: the results pad
+ * may push nothing for a long time, or at all when no beat is found, and
+ * neither sink waits on the clock */
+static gboolean
+gst_aubio_batch_src_make_job (GstAubioBatchSrc * src, GstAubioBatchJob * job,
+    const gchar * uri, const gchar * analysis)
+{
+  GstElement *decoder, *sink;
+  GstPad *pad;
+  GError *err = NULL;
+  gchar *desc;
+
+  desc = g_strdup_printf ("uridecodebin name=decoder ! audioconvert "
+      "! %s name=analysis analysis.results "
+      "! fakesink name=results async=false sync=false "
+      "analysis. ! fakesink sync=false", analysis);
+  job->pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+
+  if (err) {
+    GST_ELEMENT_ERROR (src, CORE, MISSING_PLUGIN, (NULL),
+        ("could not build analysis pipeline: %s", err->message));
+    g_error_free (err);
+    if (job->pipeline) {
+      gst_object_unref (job->pipeline);
+      job->pipeline = NULL;
+    }
+    return FALSE;
+  }
+
+  decoder = gst_bin_get_by_name (GST_BIN (job->pipeline), "decoder");
+  g_object_set (decoder, "uri", uri, NULL);
+  gst_object_unref (decoder);
+
+  sink = gst_bin_get_by_name (GST_BIN (job->pipeline), "results");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      gst_aubio_batch_src_buffer_probe, job, NULL);
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+      gst_aubio_batch_src_event_probe, job, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  job->results = g_array_new (FALSE, FALSE, sizeof (GstAubioResult));
+
+  return TRUE;
+}
+
+/* caps of the results of the analysis element of a job */
+static GstCaps *
+gst_aubio_batch_src_job_caps (GstAubioBatchJob * job)
+{
+  GstElement *analysis;
+  GstPadTemplate *templ;
+  GstCaps *caps = NULL;
+
+  analysis = gst_bin_get_by_name (GST_BIN (job->pipeline), "analysis");
+  templ = gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS
+      (analysis), "results");
+  if (templ) {
+    caps = gst_pad_template_get_caps (templ);
+  }
+  gst_object_unref (analysis);
+
+  return caps;
+}
+
+static gboolean
+gst_aubio_batch_src_start (GstBaseSrc * basesrc)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (basesrc);
+  GstStateChangeReturn ret;
+  GstQuery *query;
+  GstCaps *caps;
+  gchar *uri, *analysis;
+  guint segments, i;
+  guint64 overlap;
+  gint64 duration = -1;
+  gboolean seekable = FALSE;
+
+  GST_OBJECT_LOCK (src);
+  uri = g_strdup (src->uri);
+  analysis = g_strdup (src->analysis);
+  segments = src->segments;
+  overlap = src->overlap;
+  GST_OBJECT_UNLOCK (src);
+
+  if (uri == NULL) {
+    GST_ELEMENT_ERROR (src, RESOURCE, NOT_FOUND, (NULL),
+        ("no uri to analyse"));
+    g_free (analysis);
+    return FALSE;
+  }
+
+  if (segments == 0)
+    segments = g_get_num_processors ();
+
+  /* the first pipeline tells whether the file can be split at all */
+  src->jobs = g_new0 (GstAubioBatchJob, segments);
+  src->n_jobs = 1;
+  src->next = 0;
+  if (!gst_aubio_batch_src_make_job (src, &src->jobs[0], uri, analysis))
+    goto failed;
+
+  caps = gst_aubio_batch_src_job_caps (&src->jobs[0]);
+  if (caps == NULL || !gst_caps_is_fixed (caps)) {
+    GST_ELEMENT_ERROR (src, CORE, NEGOTIATION, (NULL),
+        ("%s has no results pad", analysis));
+    if (caps)
+      gst_caps_unref (caps);
+    goto failed;
+  }
+  /* set on the src pad in negotiate */
+  src->caps = caps;
+
+  ret = gst_element_set_state (src->jobs[0].pipeline, GST_STATE_PAUSED);
+  if (ret != GST_STATE_CHANGE_NO_PREROLL) {
+    ret = gst_element_get_state (src->jobs[0].pipeline, NULL, NULL,
+        GST_CLOCK_TIME_NONE);
+  }
+  if (ret == GST_STATE_CHANGE_FAILURE) {
+    GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ, (NULL),
+        ("could not preroll %s", uri));
+    goto failed;
+  }
+
+  if (ret != GST_STATE_CHANGE_NO_PREROLL) {
+    query = gst_query_new_seeking (GST_FORMAT_TIME);
+    if (gst_element_query (src->jobs[0].pipeline, query))
+      gst_query_parse_seeking (query, NULL, &seekable, NULL, NULL);
+    gst_query_unref (query);
+
+    if (!gst_element_query_duration (src->jobs[0].pipeline, GST_FORMAT_TIME,
+            &duration))
+      duration = -1;
+  }
+
+  /* segments shorter than the audio analysed around them are not worth
+   * it, and a stream that is live, endless or not seekable is analysed
+   * in one go */
+  if (!seekable || duration <= 0) {
+    segments = 1;
+  } else if (overlap > 0) {
+    segments = MIN (segments, MAX (duration / (2 * overlap), 1));
+  }
+
+  GST_DEBUG_OBJECT (src, "%s, duration %" GST_TIME_FORMAT ", seekable %d, "
+      "%u segments", uri, GST_TIME_ARGS (duration), seekable, segments);
+
+  for (i = 1; i < segments; i++) {
+    if (!gst_aubio_batch_src_make_job (src, &src->jobs[i], uri, analysis))
+      goto failed;
+    src->n_jobs++;
+    gst_element_set_state (src->jobs[i].pipeline, GST_STATE_PAUSED);
+  }
+
+  for (i = 0; i < segments; i++) {
+    GstAubioBatchJob *job = &src->jobs[i];
+    GstClockTime start, stop;
+
+    job->start = gst_util_uint64_scale (duration, i, segments);
+    job->stop = i + 1 < segments ?
+        gst_util_uint64_scale (duration, i + 1, segments) :
+        GST_CLOCK_TIME_NONE;
+
+    if (segments > 1) {
+      if (gst_element_get_state (job->pipeline, NULL, NULL,
+              GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE) {
+        GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ, (NULL),
+            ("could not preroll %s", uri));
+        goto failed;
+      }
+
+      start = job->start > overlap ? job->start - overlap : 0;
+      stop = job->stop != GST_CLOCK_TIME_NONE ? job->stop + overlap : 0;
+      if (!gst_element_seek (job->pipeline, 1.0, GST_FORMAT_TIME,
+              GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+              GST_SEEK_TYPE_SET, start,
+              job->stop != GST_CLOCK_TIME_NONE ? GST_SEEK_TYPE_SET :
+              GST_SEEK_TYPE_NONE, stop)) {
+        GST_ELEMENT_ERROR (src, RESOURCE, SEEK, (NULL),
+            ("could not seek to segment %u", i));
+        goto failed;
+      }
+    }
+
+    gst_element_set_state (job->pipeline, GST_STATE_PLAYING);
+  }
+
+  g_free (uri);
+  g_free (analysis);
+
+  return TRUE;
+
+failed:
+  g_free (uri);
+  g_free (analysis);
+  gst_aubio_batch_src_stop (basesrc);
+  return FALSE;
+}
+
+static gboolean
+gst_aubio_batch_src_stop (GstBaseSrc * basesrc)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (basesrc);
+  guint i;
+
+  for (i = 0; i < src->n_jobs; i++) {
+    GstAubioBatchJob *job = &src->jobs[i];
+
+    if (job->pipeline) {
+      gst_element_set_state (job->pipeline, GST_STATE_NULL);
+      gst_object_unref (job->pipeline);
+    }
+    if (job->results) {
+      g_array_free (job->results, TRUE);
+    }
+  }
+  g_free (src->jobs);
+  gst_caps_replace (&src->caps, NULL);
+
+  src->jobs = NULL;
+  src->n_jobs = 0;
+  src->next = 0;
+
+  return TRUE;
+}
+
+/* the caps are found in start, from the analysis element */
+static gboolean
+gst_aubio_batch_src_negotiate (GstBaseSrc * basesrc)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (basesrc);
+
+  return src->caps != NULL && gst_base_src_set_caps (basesrc, src->caps);
+}
+
+static gboolean
+gst_aubio_batch_src_is_seekable (GstBaseSrc * basesrc)
+{
+  return FALSE;
+}
+
+static gboolean
+gst_aubio_batch_src_unlock (GstBaseSrc * basesrc)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (basesrc);
+
+  g_atomic_int_set (&src->flushing, TRUE);
+  return TRUE;
+}
+
+static gboolean
+gst_aubio_batch_src_unlock_stop (GstBaseSrc * basesrc)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (basesrc);
+
+  g_atomic_int_set (&src->flushing, FALSE);
+  return TRUE;
+}
+
+/* wait for the pipeline of a job to reach EOS, discarding its other
+ * messages as they come */
+static GstFlowReturn
+gst_aubio_batch_src_wait_job (GstAubioBatchSrc * src, GstAubioBatchJob * job)
+{
+  GstBus *bus;
+  GstMessage *msg;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gboolean done = FALSE;
+
+  bus = gst_element_get_bus (job->pipeline);
+  while (!done) {
+    if (g_atomic_int_get (&src->flushing)) {
+      ret = GST_FLOW_FLUSHING;
+      break;
+    }
+
+    msg = gst_bus_timed_pop (bus, POLL_INTERVAL);
+    if (msg == NULL)
+      continue;
+
+    switch (GST_MESSAGE_TYPE (msg)) {
+      case GST_MESSAGE_EOS:
+        done = TRUE;
+        break;
+      case GST_MESSAGE_ERROR:{
+        GError *err = NULL;
+        gchar *debug = NULL;
+
+        gst_message_parse_error (msg, &err, &debug);
+        GST_ELEMENT_ERROR (src, STREAM, FAILED, (NULL),
+            ("segment %u: %s (%s)", src->next, err->message,
+                GST_STR_NULL (debug)));
+        g_error_free (err);
+        g_free (debug);
+        ret = GST_FLOW_ERROR;
+        done = TRUE;
+        break;
+      }
+      default:
+        break;
+    }
+    gst_message_unref (msg);
+  }
+  gst_object_unref (bus);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_aubio_batch_src_create (GstBaseSrc * basesrc, guint64 offset,
+    guint size, GstBuffer ** buf)
+{
+  GstAubioBatchSrc *src = GST_AUBIO_BATCH_SRC (basesrc);
+  GstAubioBatchJob *job;
+  GstAubioResult *out;
+  GstFlowReturn ret;
+  guint i, len = 0;
+
+  if (src->next >= src->n_jobs)
+    return GST_FLOW_EOS;
+
+  job = &src->jobs[src->next];
+  ret = gst_aubio_batch_src_wait_job (src, job);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  /* keep the results of the segment itself, the ones of the overlaps
+   * come from the neighbouring jobs */
+  out = g_new (GstAubioResult, job->results->len);
+  for (i = 0; i < job->results->len; i++) {
+    const GstAubioResult *r = &g_array_index (job->results,
+        GstAubioResult, i);
+
+    if (r->timestamp < job->start && src->next > 0)
+      continue;
+    if (job->stop != GST_CLOCK_TIME_NONE && r->timestamp >= job->stop)
+      continue;
+    out[len++] = *r;
+  }
+  if (len > 0) {
+    *buf = gst_buffer_new_wrapped (out, len * sizeof (GstAubioResult));
+  } else {
+    g_free (out);
+    *buf = gst_buffer_new ();
+  }
+  GST_BUFFER_PTS (*buf) = job->start;
+  GST_BUFFER_DURATION (*buf) = job->stop != GST_CLOCK_TIME_NONE ?
+      job->stop - job->start : GST_CLOCK_TIME_NONE;
+
+  GST_DEBUG_OBJECT (src, "segment %u: %u of %u results", src->next, len,
+      job->results->len);
+
+  /* the pipeline is done, release its decoder */
+  gst_element_set_state (job->pipeline, GST_STATE_NULL);
+  g_array_set_size (job->results, 0);
+  src->next++;
+
+  return GST_FLOW_OK;
+}
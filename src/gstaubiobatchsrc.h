@@ -0,0 +1,86 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GST_AUBIO_BATCH_SRC_H__
+#define __GST_AUBIO_BATCH_SRC_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesrc.h>
+
+#include "gstaubioresults.h"
+
+G_BEGIN_DECLS
+
+/* #defines don't like whitespacey bits */
+#define GST_TYPE_AUBIO_BATCH_SRC \
+  (gst_aubio_batch_src_get_type())
+#define GST_AUBIO_BATCH_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_AUBIO_BATCH_SRC,GstAubioBatchSrc))
+#define GST_IS_AUBIO_BATCH_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_AUBIO_BATCH_SRC))
+#define GST_AUBIO_BATCH_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_AUBIO_BATCH_SRC,GstAubioBatchSrcClass))
+#define GST_IS_AUBIO_BATCH_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_AUBIO_BATCH_SRC))
+#define GST_AUBIO_BATCH_SRC_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_AUBIO_BATCH_SRC, GstAubioBatchSrcClass))
+
+typedef struct _GstAubioBatchSrc      GstAubioBatchSrc;
+typedef struct _GstAubioBatchSrcClass GstAubioBatchSrcClass;
+
+/* one segment of the input, analysed by a pipeline of its own */
+typedef struct
+{
+  GstElement *pipeline;
+  GstClockTime start;           /* results kept from this time */
+  GstClockTime stop;            /* up to this one, NONE for the last */
+  GArray *results;              /* GstAubioResult, written by the streaming
+                                 * thread of the pipeline until EOS */
+} GstAubioBatchJob;
+
+struct _GstAubioBatchSrc
+{
+  GstBaseSrc element;
+
+  /* protected by the object lock, read in start */
+  gchar * uri;
+  gchar * analysis;     /* description of the analysis element */
+  guint segments;       /* 0 for one per processor */
+  guint64 overlap;      /* analysed ahead of and after each segment */
+
+  GstCaps * caps;       /* of the results of the analysis element */
+  GstAubioBatchJob * jobs;
+  guint n_jobs;
+  guint next;           /* job whose results are pushed next */
+  gint flushing;        /* set in unlock, atomic */
+};
+
+struct _GstAubioBatchSrcClass
+{
+  GstBaseSrcClass parent_class;
+};
+
+GType gst_aubio_batch_src_get_type (void);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_BATCH_SRC_H__ */
@@ -0,0 +1,131 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "gstaubiocache.h"
+
+G_LOCK_DEFINE_STATIC (cache);
+/* key string -> GSList of idle detectors, protected by the cache lock */
+static GHashTable *pitch_cache = NULL;
+
+static gchar *
+gst_aubio_cache_key (const gchar * method, uint buf_size, uint hop_size,
+    uint rate)
+{
+  return g_strdup_printf ("%s/%u/%u/%u", method, buf_size, hop_size, rate);
+}
+
+aubio_pitch_t *
+gst_aubio_cache_get_pitch (const gchar * method, uint buf_size,
+    uint hop_size, uint rate, gboolean * reused)
+{
+  aubio_pitch_t *pitch = NULL;
+  gchar *key;
+  GSList *idle;
+
+  key = gst_aubio_cache_key (method, buf_size, hop_size, rate);
+
+  G_LOCK (cache);
+  if (pitch_cache) {
+    idle = g_hash_table_lookup (pitch_cache, key);
+    if (idle) {
+      pitch = idle->data;
+      idle = g_slist_delete_link (idle, idle);
+      /* the table keeps its key, only the list changes */
+      g_hash_table_insert (pitch_cache, g_strdup (key), idle);
+    }
+  }
+  G_UNLOCK (cache);
+
+  *reused = pitch != NULL;
+  if (pitch) {
+    GST_LOG ("reusing %s pitch detector", key);
+  } else {
+    GST_LOG ("creating %s pitch detector", key);
+    pitch = new_aubio_pitch (method, buf_size, hop_size, rate);
+  }
+  g_free (key);
+
+  return pitch;
+}
+
+void
+gst_aubio_cache_put_pitch (aubio_pitch_t * pitch, const gchar * method,
+    uint buf_size, uint hop_size, uint rate)
+{
+  gchar *key;
+  GSList *idle = NULL;
+
+  if (pitch == NULL)
+    return;
+
+  key = gst_aubio_cache_key (method, buf_size, hop_size, rate);
+
+  G_LOCK (cache);
+  if (pitch_cache == NULL) {
+    pitch_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        NULL);
+  }
+  idle = g_hash_table_lookup (pitch_cache, key);
+  if (g_slist_length (idle) < GST_AUBIO_CACHE_SIZE) {
+    g_hash_table_insert (pitch_cache, key, g_slist_prepend (idle, pitch));
+    key = NULL;
+    pitch = NULL;
+  }
+  G_UNLOCK (cache);
+
+  if (pitch) {
+    del_aubio_pitch (pitch);
+  }
+  g_free (key);
+}
+
+#ifdef __GNUC__
+/* GStreamer has no hook for the unloading of a plugin, free the idle
+ * detectors along with the module */
+static void
+gst_aubio_cache_free_idle (gpointer data)
+{
+  del_aubio_pitch (data);
+}
+
+static void __attribute__ ((destructor))
+gst_aubio_cache_free (void)
+{
+  GHashTableIter iter;
+  gpointer idle;
+
+  G_LOCK (cache);
+  if (pitch_cache) {
+    g_hash_table_iter_init (&iter, pitch_cache);
+    while (g_hash_table_iter_next (&iter, NULL, &idle)) {
+      g_slist_free_full (idle, gst_aubio_cache_free_idle);
+    }
+    g_hash_table_destroy (pitch_cache);
+    pitch_cache = NULL;
+  }
+  G_UNLOCK (cache);
+}
+#endif
@@ -0,0 +1,49 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GST_AUBIO_CACHE_H__
+#define __GST_AUBIO_CACHE_H__
+
+#include <gst/gst.h>
+
+#include <aubio/aubio.h>
+
+G_BEGIN_DECLS
+
+/* detectors kept for reuse for each (method, buf_size, hop_size, rate) */
+#define GST_AUBIO_CACHE_SIZE 16
+
+/* Process wide cache of pitch detectors. Creating one sets up its FFT and
+ * work buffers, so elements created in bursts check out the detectors
+ * others have returned instead. A reused detector still holds the end of
+ * the previous stream in its window, reused is set so that the caller
+ * disregards its first hops; the tuning (tolerance, silence) is left to
+ * the caller too. The idle detectors are freed when the plugin is
+ * unloaded. */
+aubio_pitch_t * gst_aubio_cache_get_pitch (const gchar * method,
+    uint buf_size, uint hop_size, uint rate, gboolean * reused);
+void gst_aubio_cache_put_pitch (aubio_pitch_t * pitch, const gchar * method,
+    uint buf_size, uint hop_size, uint rate);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_CACHE_H__ */
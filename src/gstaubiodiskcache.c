@@ -0,0 +1,439 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "gstaubiodiskcache.h"
+
+#define MAGIC 0x41554243        /* "AUBC" */
+#define VERSION 1
+
+#define DIGEST_SIZE 32          /* SHA-256 */
+
+typedef struct
+{
+  guint32 magic;
+  guint32 version;
+  guint32 channels;
+  guint32 hop_size;
+  guint32 chunk_hops;
+  guint32 params_len;
+} CacheHeader;
+
+typedef struct
+{
+  guint8 digest[DIGEST_SIZE];
+  guint32 n_hops;
+  guint32 n_records;
+} ChunkHeader;
+
+typedef struct
+{
+  guint32 n_chunks;
+  guint32 magic;
+} CacheTrailer;
+
+#define PAD8(n) (((n) + 7) & ~7)
+
+void
+gst_aubio_disk_cache_init (GstAubioDiskCache * cache)
+{
+  memset (cache, 0, sizeof (GstAubioDiskCache));
+  cache->state = GST_AUBIO_DISK_CACHE_OFF;
+  cache->records = g_array_new (FALSE, FALSE, sizeof (GstAubioCacheRecord));
+  cache->index = g_array_new (FALSE, FALSE, sizeof (guint64));
+}
+
+void
+gst_aubio_disk_cache_free (GstAubioDiskCache * cache)
+{
+  gst_aubio_disk_cache_stop (cache);
+  g_array_free (cache->records, TRUE);
+  g_array_free (cache->index, TRUE);
+}
+
+static void
+gst_aubio_disk_cache_close_entry (GstAubioDiskCache * cache)
+{
+  if (cache->file) {
+    fclose (cache->file);
+    g_unlink (cache->tmp_path);
+    cache->file = NULL;
+  }
+  g_free (cache->tmp_path);
+  cache->tmp_path = NULL;
+  g_array_set_size (cache->index, 0);
+
+  g_free (cache->contents);
+  cache->contents = NULL;
+  cache->length = 0;
+  cache->offsets = NULL;
+  cache->n_chunks = 0;
+  cache->replay = NULL;
+  cache->n_replay = 0;
+}
+
+void
+gst_aubio_disk_cache_stop (GstAubioDiskCache * cache)
+{
+  gst_aubio_disk_cache_close_entry (cache);
+
+  if (cache->sum) {
+    g_checksum_free (cache->sum);
+    cache->sum = NULL;
+  }
+  g_free (cache->samples);
+  g_free (cache->params);
+  g_free (cache->path);
+  cache->samples = NULL;
+  cache->params = NULL;
+  cache->path = NULL;
+  cache->n_hops = 0;
+  g_array_set_size (cache->records, 0);
+  cache->state = GST_AUBIO_DISK_CACHE_OFF;
+}
+
+void
+gst_aubio_disk_cache_start (GstAubioDiskCache * cache,
+    const gchar * location, const gchar * params, guint channels,
+    guint hop_size)
+{
+  gst_aubio_disk_cache_stop (cache);
+
+  if (location == NULL)
+    return;
+
+  if (g_mkdir_with_parents (location, 0755) != 0) {
+    GST_WARNING ("could not create cache directory %s", location);
+    return;
+  }
+
+  cache->path = g_strdup (location);
+  cache->params = g_strdup (params);
+  cache->channels = channels;
+  cache->hop_size = hop_size;
+  cache->sum = g_checksum_new (G_CHECKSUM_SHA256);
+  cache->samples = g_new (smpl_t,
+      GST_AUBIO_DISK_CACHE_CHUNK * channels * hop_size);
+  cache->chunk = 0;
+  cache->state = GST_AUBIO_DISK_CACHE_PROBE;
+}
+
+void
+gst_aubio_disk_cache_add_hop (GstAubioDiskCache * cache, fvec_t ** hops,
+    guint64 end)
+{
+  smpl_t *dst;
+  guint c;
+
+  if (cache->state == GST_AUBIO_DISK_CACHE_OFF)
+    return;
+
+  g_return_if_fail (cache->n_hops < GST_AUBIO_DISK_CACHE_CHUNK);
+
+  dst = cache->samples + cache->n_hops * cache->channels * cache->hop_size;
+  for (c = 0; c < cache->channels; c++) {
+    memcpy (dst + c * cache->hop_size, hops[c]->data,
+        cache->hop_size * sizeof (smpl_t));
+  }
+  g_checksum_update (cache->sum, (const guchar *) dst,
+      cache->channels * cache->hop_size * sizeof (smpl_t));
+  cache->ends[cache->n_hops++] = end;
+}
+
+void
+gst_aubio_disk_cache_add_result (GstAubioDiskCache * cache, guint channel,
+    gfloat value, gfloat confidence)
+{
+  GstAubioCacheRecord r;
+
+  if (cache->state != GST_AUBIO_DISK_CACHE_PROBE &&
+      cache->state != GST_AUBIO_DISK_CACHE_RECORD)
+    return;
+
+  /* zeros are implied */
+  if (value == 0. && confidence == 0.)
+    return;
+
+  r.hop = cache->n_hops - 1;
+  r.channel = channel;
+  r.value = value;
+  r.confidence = confidence;
+  g_array_append_val (cache->records, r);
+}
+
+static gboolean
+gst_aubio_disk_cache_write (GstAubioDiskCache * cache, gconstpointer data,
+    gsize size)
+{
+  if (fwrite (data, 1, size, cache->file) == size)
+    return TRUE;
+
+  GST_WARNING ("could not write cache entry %s", cache->tmp_path);
+  gst_aubio_disk_cache_stop (cache);
+  return FALSE;
+}
+
+/* append the current chunk to the entry being written */
+static void
+gst_aubio_disk_cache_write_chunk (GstAubioDiskCache * cache,
+    const guint8 * digest)
+{
+  ChunkHeader h;
+  guint64 offset = ftell (cache->file);
+
+  memcpy (h.digest, digest, DIGEST_SIZE);
+  h.n_hops = cache->n_hops;
+  h.n_records = cache->records->len;
+
+  g_array_append_val (cache->index, offset);
+  if (gst_aubio_disk_cache_write (cache, &h, sizeof (h)))
+    gst_aubio_disk_cache_write (cache, cache->records->data,
+        cache->records->len * sizeof (GstAubioCacheRecord));
+}
+
+/* load the entry at path, TRUE when it is complete and was written with
+ * the same settings */
+static gboolean
+gst_aubio_disk_cache_load (GstAubioDiskCache * cache, const gchar * path)
+{
+  const CacheHeader *h;
+  const CacheTrailer *t;
+  gsize params_len, start, i;
+
+  if (!g_file_get_contents (path, &cache->contents, &cache->length, NULL))
+    return FALSE;
+
+  params_len = strlen (cache->params);
+  start = sizeof (CacheHeader) + PAD8 (params_len);
+  if (cache->length < start + sizeof (CacheTrailer))
+    goto invalid;
+
+  h = (const CacheHeader *) cache->contents;
+  t = (const CacheTrailer *) (cache->contents + cache->length -
+      sizeof (CacheTrailer));
+  if (h->magic != MAGIC || h->version != VERSION || t->magic != MAGIC
+      || h->channels != cache->channels || h->hop_size != cache->hop_size
+      || h->chunk_hops != GST_AUBIO_DISK_CACHE_CHUNK
+      || h->params_len != params_len
+      || memcmp (cache->contents + sizeof (CacheHeader), cache->params,
+          params_len) != 0)
+    goto invalid;
+
+  cache->n_chunks = t->n_chunks;
+  if (cache->length < start + sizeof (CacheTrailer) +
+      (gsize) cache->n_chunks * sizeof (guint64))
+    goto invalid;
+  cache->offsets = (const guint64 *) (cache->contents + cache->length -
+      sizeof (CacheTrailer) - cache->n_chunks * sizeof (guint64));
+
+  for (i = 0; i < cache->n_chunks; i++) {
+    const ChunkHeader *c;
+
+    if (cache->offsets[i] < start || cache->offsets[i] + sizeof (ChunkHeader)
+        > (const gchar *) cache->offsets - cache->contents)
+      goto invalid;
+    c = (const ChunkHeader *) (cache->contents + cache->offsets[i]);
+    if (cache->offsets[i] + sizeof (ChunkHeader) + (guint64) c->n_records *
+        sizeof (GstAubioCacheRecord) >
+        (guint64) ((const gchar *) cache->offsets - cache->contents))
+      goto invalid;
+  }
+
+  return TRUE;
+
+invalid:
+  GST_WARNING ("ignoring invalid cache entry %s", path);
+  gst_aubio_disk_cache_close_entry (cache);
+  return FALSE;
+}
+
+/* the first chunk is in: replay the entry it names or start writing it */
+static void
+gst_aubio_disk_cache_open (GstAubioDiskCache * cache, const guint8 * digest)
+{
+  GChecksum *key;
+  CacheHeader h;
+  gchar *name, *dir = cache->path;
+  const gchar zeros[8] = { 0, };
+  gint fd;
+
+  key = g_checksum_new (G_CHECKSUM_SHA256);
+  g_checksum_update (key, (const guchar *) cache->params, -1);
+  g_checksum_update (key, digest, DIGEST_SIZE);
+  name = g_strconcat (g_checksum_get_string (key), ".aubio", NULL);
+  cache->path = g_build_filename (dir, name, NULL);
+  g_checksum_free (key);
+  g_free (name);
+  g_free (dir);
+
+  if (gst_aubio_disk_cache_load (cache, cache->path)) {
+    GST_DEBUG ("replaying %s", cache->path);
+    cache->state = GST_AUBIO_DISK_CACHE_REPLAY;
+    cache->chunk = 1;
+    return;
+  }
+
+  cache->tmp_path = g_strconcat (cache->path, ".XXXXXX", NULL);
+  fd = g_mkstemp (cache->tmp_path);
+  if (fd < 0 || (cache->file = fdopen (fd, "wb")) == NULL) {
+    GST_WARNING ("could not create cache entry %s", cache->tmp_path);
+    if (fd >= 0) {
+      close (fd);
+      g_unlink (cache->tmp_path);
+    }
+    gst_aubio_disk_cache_stop (cache);
+    return;
+  }
+  GST_DEBUG ("writing %s", cache->path);
+  cache->state = GST_AUBIO_DISK_CACHE_RECORD;
+
+  h.magic = MAGIC;
+  h.version = VERSION;
+  h.channels = cache->channels;
+  h.hop_size = cache->hop_size;
+  h.chunk_hops = GST_AUBIO_DISK_CACHE_CHUNK;
+  h.params_len = strlen (cache->params);
+  if (gst_aubio_disk_cache_write (cache, &h, sizeof (h))
+      && gst_aubio_disk_cache_write (cache, cache->params, h.params_len)
+      && gst_aubio_disk_cache_write (cache, zeros,
+          PAD8 (h.params_len) - h.params_len))
+    gst_aubio_disk_cache_write_chunk (cache, digest);
+}
+
+GstAubioDiskCacheChunk
+gst_aubio_disk_cache_end_chunk (GstAubioDiskCache * cache)
+{
+  guint8 digest[DIGEST_SIZE];
+  gsize len = DIGEST_SIZE;
+  const ChunkHeader *c;
+
+  if (cache->state == GST_AUBIO_DISK_CACHE_OFF || cache->n_hops == 0)
+    return GST_AUBIO_DISK_CACHE_ANALYSED;
+
+  g_checksum_get_digest (cache->sum, digest, &len);
+
+  switch (cache->state) {
+    case GST_AUBIO_DISK_CACHE_PROBE:
+      gst_aubio_disk_cache_open (cache, digest);
+      return GST_AUBIO_DISK_CACHE_ANALYSED;
+    case GST_AUBIO_DISK_CACHE_RECORD:
+      gst_aubio_disk_cache_write_chunk (cache, digest);
+      return GST_AUBIO_DISK_CACHE_ANALYSED;
+    default:
+      break;
+  }
+
+  if (cache->chunk < cache->n_chunks) {
+    c = (const ChunkHeader *) (cache->contents +
+        cache->offsets[cache->chunk]);
+    if (c->n_hops == cache->n_hops
+        && memcmp (c->digest, digest, DIGEST_SIZE) == 0) {
+      cache->replay = (const GstAubioCacheRecord *) (c + 1);
+      cache->n_replay = c->n_records;
+      cache->cursor = 0;
+      cache->chunk++;
+      return GST_AUBIO_DISK_CACHE_HIT;
+    }
+  }
+
+  GST_DEBUG ("stream differs from %s at chunk %u", cache->path,
+      cache->chunk);
+  /* keep the hops of the chunk for the caller, drop the rest */
+  gst_aubio_disk_cache_close_entry (cache);
+  cache->state = GST_AUBIO_DISK_CACHE_OFF;
+  return GST_AUBIO_DISK_CACHE_MISS;
+}
+
+void
+gst_aubio_disk_cache_result (GstAubioDiskCache * cache, guint h,
+    guint channel, gfloat * value, gfloat * confidence)
+{
+  const GstAubioCacheRecord *r = cache->replay + cache->cursor;
+
+  if (cache->cursor < cache->n_replay && r->hop == h
+      && r->channel == channel) {
+    *value = r->value;
+    *confidence = r->confidence;
+    cache->cursor++;
+  } else {
+    *value = 0.;
+    *confidence = 0.;
+  }
+}
+
+void
+gst_aubio_disk_cache_hop (GstAubioDiskCache * cache, guint h, guint channel,
+    fvec_t * hop)
+{
+  hop->length = cache->hop_size;
+  hop->data = cache->samples + (h * cache->channels + channel) *
+      cache->hop_size;
+}
+
+void
+gst_aubio_disk_cache_next_chunk (GstAubioDiskCache * cache)
+{
+  if (cache->state == GST_AUBIO_DISK_CACHE_OFF) {
+    /* after a miss */
+    gst_aubio_disk_cache_stop (cache);
+    return;
+  }
+
+  cache->n_hops = 0;
+  g_checksum_reset (cache->sum);
+  g_array_set_size (cache->records, 0);
+  cache->replay = NULL;
+  cache->n_replay = 0;
+}
+
+void
+gst_aubio_disk_cache_finish (GstAubioDiskCache * cache)
+{
+  CacheTrailer t;
+
+  if (cache->state == GST_AUBIO_DISK_CACHE_RECORD) {
+    t.n_chunks = cache->index->len;
+    t.magic = MAGIC;
+    if (gst_aubio_disk_cache_write (cache, cache->index->data,
+            cache->index->len * sizeof (guint64))
+        && gst_aubio_disk_cache_write (cache, &t, sizeof (t))) {
+      if (fclose (cache->file) == 0
+          && g_rename (cache->tmp_path, cache->path) == 0) {
+        GST_DEBUG ("wrote %s, %u chunks", cache->path, t.n_chunks);
+      } else {
+        GST_WARNING ("could not complete cache entry %s", cache->path);
+        g_unlink (cache->tmp_path);
+      }
+      cache->file = NULL;
+    }
+  }
+
+  gst_aubio_disk_cache_stop (cache);
+}
@@ -0,0 +1,155 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GST_AUBIO_DISK_CACHE_H__
+#define __GST_AUBIO_DISK_CACHE_H__
+
+#include <stdio.h>
+
+#include <gst/gst.h>
+
+#include <aubio/aubio.h>
+
+G_BEGIN_DECLS
+
+/* hops of every channel per chunk, the unit entries are checked by */
+#define GST_AUBIO_DISK_CACHE_CHUNK 64
+
+/* Results of analysed streams kept on disk, keyed by a hash of the
+ * analysis settings and of the first chunk of audio, so that analysing
+ * the same audio again replays them instead of running the detectors.
+ *
+ * The stream is cut in chunks of GST_AUBIO_DISK_CACHE_CHUNK hops. The
+ * first one is always analysed; its hash then names the entry. Without an
+ * entry, the results of every chunk are written to a new one, completed
+ * at EOS. With one, each following chunk is hashed as it arrives and,
+ * when it matches the entry, its results are taken from there once its
+ * last hop is in. At the first chunk that does not match, the element
+ * analyses the hops of that chunk and the rest of the stream.
+ *
+ * An entry is, in native byte order: a header (magic, version, channels,
+ * hop_size, chunk size, length of the settings, the settings padded to 8
+ * bytes), each chunk (SHA-256 of its samples, number of hops and of
+ * records, then its non-zero GstAubioCacheRecords), the offset of each
+ * chunk in the file, and a trailer (number of chunks, magic). */
+
+/* detector output of one channel for one hop of a chunk */
+typedef struct
+{
+  guint32 hop;                  /* within its chunk */
+  guint32 channel;
+  gfloat value;
+  gfloat confidence;
+} GstAubioCacheRecord;
+
+typedef enum
+{
+  GST_AUBIO_DISK_CACHE_OFF,
+  GST_AUBIO_DISK_CACHE_PROBE,   /* analysing the first chunk */
+  GST_AUBIO_DISK_CACHE_RECORD,  /* analysing, writing a new entry */
+  GST_AUBIO_DISK_CACHE_REPLAY   /* replaying an entry */
+} GstAubioDiskCacheState;
+
+/* what to do with a complete chunk */
+typedef enum
+{
+  GST_AUBIO_DISK_CACHE_ANALYSED,        /* its hops were analysed already */
+  GST_AUBIO_DISK_CACHE_HIT,     /* report its results from the entry */
+  GST_AUBIO_DISK_CACHE_MISS     /* analyse its hops, the cache is off */
+} GstAubioDiskCacheChunk;
+
+typedef struct
+{
+  GstAubioDiskCacheState state;
+  gchar *path;                  /* of the entry */
+  gchar *params;                /* analysis settings, part of the key */
+  guint channels;
+  guint hop_size;
+
+  /* current chunk, hops are copied so that they can still be analysed
+   * once a replayed chunk turns out to differ */
+  GChecksum *sum;
+  guint n_hops;
+  guint64 ends[GST_AUBIO_DISK_CACHE_CHUNK];     /* end of each hop */
+  smpl_t *samples;
+  GArray *records;              /* results of its hops, when analysed */
+
+  /* entry being written */
+  FILE *file;
+  gchar *tmp_path;
+  GArray *index;                /* offset of each chunk written */
+
+  /* entry being replayed */
+  gchar *contents;
+  gsize length;
+  const guint64 *offsets;
+  guint n_chunks;
+  guint chunk;                  /* next chunk to compare */
+  const GstAubioCacheRecord *replay;    /* results of the chunk to report */
+  guint n_replay;
+  guint cursor;
+} GstAubioDiskCache;
+
+void gst_aubio_disk_cache_init (GstAubioDiskCache * cache);
+void gst_aubio_disk_cache_free (GstAubioDiskCache * cache);
+
+/* start over at the beginning of a stream, a NULL location turns the
+ * cache off */
+void gst_aubio_disk_cache_start (GstAubioDiskCache * cache,
+    const gchar * location, const gchar * params, guint channels,
+    guint hop_size);
+/* give up the current stream, discarding the entry being written and
+ * the hops of the current chunk, such as when the settings change */
+void gst_aubio_disk_cache_stop (GstAubioDiskCache * cache);
+
+/* add one hop of every channel to the current chunk, end is passed back
+ * in ends for reporting */
+void gst_aubio_disk_cache_add_hop (GstAubioDiskCache * cache, fvec_t ** hops,
+    guint64 end);
+/* output of the detector of channel for the last hop added */
+void gst_aubio_disk_cache_add_result (GstAubioDiskCache * cache,
+    guint channel, gfloat value, gfloat confidence);
+
+/* check the current chunk against the entry, or write it */
+GstAubioDiskCacheChunk gst_aubio_disk_cache_end_chunk (GstAubioDiskCache *
+    cache);
+/* after a hit, the output of channel for hop h of the chunk, in order */
+void gst_aubio_disk_cache_result (GstAubioDiskCache * cache, guint h,
+    guint channel, gfloat * value, gfloat * confidence);
+/* after a miss, hop h of channel */
+void gst_aubio_disk_cache_hop (GstAubioDiskCache * cache, guint h,
+    guint channel, fvec_t * hop);
+/* once the chunk is reported or analysed */
+void gst_aubio_disk_cache_next_chunk (GstAubioDiskCache * cache);
+
+/* at EOS, after the last chunk: complete the entry being written */
+void gst_aubio_disk_cache_finish (GstAubioDiskCache * cache);
+
+static inline gboolean
+gst_aubio_disk_cache_replaying (GstAubioDiskCache * cache)
+{
+  return cache->state == GST_AUBIO_DISK_CACHE_REPLAY;
+}
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_DISK_CACHE_H__ */
@@ -0,0 +1,234 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include "gstaubiolog.h"
+
+#define HEADER_SIZE sizeof (GstAubioLogHeader)
+#define RECORD_SIZE sizeof (GstAubioLogRecord)
+
+void
+gst_aubio_log_init (GstAubioLog * rlog)
+{
+  g_mutex_init (&rlog->lock);
+  rlog->fd = -1;
+  rlog->header = NULL;
+  rlog->size = 0;
+  rlog->capacity = 0;
+  rlog->stream = 0;
+  rlog->unsynced = 0;
+}
+
+void
+gst_aubio_log_clear (GstAubioLog * rlog)
+{
+  gst_aubio_log_close (rlog);
+  g_mutex_clear (&rlog->lock);
+}
+
+/* map the file with room for capacity records, growing it as needed */
+static gboolean
+gst_aubio_log_map (GstAubioLog * rlog, guint capacity)
+{
+  gsize size = HEADER_SIZE + (gsize) capacity * RECORD_SIZE;
+  gpointer map;
+
+  if (ftruncate (rlog->fd, size) != 0)
+    return FALSE;
+
+  map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, rlog->fd, 0);
+  if (map == MAP_FAILED)
+    return FALSE;
+
+  if (rlog->header) {
+    munmap (rlog->header, rlog->size);
+  }
+  rlog->header = map;
+  rlog->size = size;
+  rlog->capacity = capacity;
+
+  return TRUE;
+}
+
+/* whether the file holds a log this version can append to */
+static gboolean
+gst_aubio_log_check (gint fd, GstAubioLogHeader * header)
+{
+  struct stat st;
+
+  if (fstat (fd, &st) != 0 || st.st_size < (off_t) HEADER_SIZE)
+    return FALSE;
+  if (pread (fd, header, HEADER_SIZE, 0) != (ssize_t) HEADER_SIZE)
+    return FALSE;
+
+  return header->magic == GST_AUBIO_LOG_MAGIC
+      && header->version == GST_AUBIO_LOG_VERSION
+      && header->header_size == HEADER_SIZE
+      && header->record_size == RECORD_SIZE
+      && header->records >= 0
+      && (guint64) st.st_size >= HEADER_SIZE
+      + (guint64) header->records * RECORD_SIZE;
+}
+
+gboolean
+gst_aubio_log_open (GstAubioLog * rlog, GstObject * element,
+    const gchar * location)
+{
+  GstAubioLogHeader header;
+  gboolean append;
+  guint records = 0;
+
+  gst_aubio_log_close (rlog);
+
+  g_mutex_lock (&rlog->lock);
+  rlog->fd = g_open (location, O_RDWR | O_CREAT, 0644);
+  if (rlog->fd == -1) {
+    g_mutex_unlock (&rlog->lock);
+    GST_ELEMENT_ERROR (element, RESOURCE, OPEN_WRITE, (NULL),
+        ("could not open result log %s: %s", location, g_strerror (errno)));
+    return FALSE;
+  }
+
+  append = gst_aubio_log_check (rlog->fd, &header);
+  if (append) {
+    records = header.records;
+  } else {
+    struct stat st;
+
+    /* never overwrite a file that is not an empty or new log */
+    if (fstat (rlog->fd, &st) != 0 || st.st_size != 0) {
+      close (rlog->fd);
+      rlog->fd = -1;
+      g_mutex_unlock (&rlog->lock);
+      GST_ELEMENT_ERROR (element, RESOURCE, OPEN_WRITE, (NULL),
+          ("%s exists and is not a result log", location));
+      return FALSE;
+    }
+    GST_DEBUG_OBJECT (element, "starting a new result log in %s", location);
+  }
+
+  if (!gst_aubio_log_map (rlog, records + GST_AUBIO_LOG_GROW)) {
+    close (rlog->fd);
+    rlog->fd = -1;
+    g_mutex_unlock (&rlog->lock);
+    GST_ELEMENT_ERROR (element, RESOURCE, OPEN_WRITE, (NULL),
+        ("could not map result log %s: %s", location, g_strerror (errno)));
+    return FALSE;
+  }
+
+  if (!append) {
+    memset (rlog->header, 0, HEADER_SIZE);
+    rlog->header->magic = GST_AUBIO_LOG_MAGIC;
+    rlog->header->version = GST_AUBIO_LOG_VERSION;
+    rlog->header->header_size = HEADER_SIZE;
+    rlog->header->record_size = RECORD_SIZE;
+  }
+  rlog->stream = rlog->header->streams;
+  rlog->unsynced = 0;
+  g_mutex_unlock (&rlog->lock);
+
+  return TRUE;
+}
+
+void
+gst_aubio_log_close (GstAubioLog * rlog)
+{
+  gsize used;
+
+  g_mutex_lock (&rlog->lock);
+  if (rlog->fd != -1) {
+    used = HEADER_SIZE + (gsize) rlog->header->records * RECORD_SIZE;
+    msync (rlog->header, rlog->size, MS_SYNC);
+    munmap (rlog->header, rlog->size);
+    /* give back the space allocated ahead */
+    if (ftruncate (rlog->fd, used) != 0) {
+      GST_WARNING ("could not truncate result log: %s", g_strerror (errno));
+    }
+    close (rlog->fd);
+  }
+  rlog->fd = -1;
+  rlog->header = NULL;
+  rlog->size = 0;
+  rlog->capacity = 0;
+  g_mutex_unlock (&rlog->lock);
+}
+
+void
+gst_aubio_log_new_stream (GstAubioLog * rlog)
+{
+  g_mutex_lock (&rlog->lock);
+  if (rlog->fd != -1) {
+    rlog->stream = rlog->header->streams + 1;
+    g_atomic_int_set (&rlog->header->streams, rlog->stream);
+  }
+  g_mutex_unlock (&rlog->lock);
+}
+
+void
+gst_aubio_log_append (GstAubioLog * rlog, const GstAubioResult * result)
+{
+  GstAubioLogRecord *r;
+  guint n;
+
+  g_mutex_lock (&rlog->lock);
+  if (rlog->fd == -1) {
+    g_mutex_unlock (&rlog->lock);
+    return;
+  }
+
+  n = rlog->header->records;
+  if (n == rlog->capacity
+      && !gst_aubio_log_map (rlog, rlog->capacity + GST_AUBIO_LOG_GROW)) {
+    GST_WARNING ("could not grow result log, result dropped: %s",
+        g_strerror (errno));
+    g_mutex_unlock (&rlog->lock);
+    return;
+  }
+
+  r = (GstAubioLogRecord *) ((guint8 *) rlog->header + HEADER_SIZE) + n;
+  r->timestamp = result->timestamp;
+  r->value = result->value;
+  r->confidence = result->confidence;
+  r->stream = rlog->stream;
+  r->channel = result->channel;
+  r->kind = result->kind;
+  /* publish the record to readers once it is complete */
+  g_atomic_int_set (&rlog->header->records, n + 1);
+
+  if (++rlog->unsynced >= GST_AUBIO_LOG_SYNC) {
+    msync (rlog->header, rlog->size, MS_ASYNC);
+    rlog->unsynced = 0;
+  }
+  g_mutex_unlock (&rlog->lock);
+}
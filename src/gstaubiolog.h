@@ -0,0 +1,103 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GST_AUBIO_LOG_H__
+#define __GST_AUBIO_LOG_H__
+
+#include <gst/gst.h>
+
+#include "gstaubioresults.h"
+
+G_BEGIN_DECLS
+
+#define GST_AUBIO_LOG_MAGIC 0x4c425541  /* "AUBL" */
+#define GST_AUBIO_LOG_VERSION 1
+
+/* Append-only file of fixed-size result records, written through a shared
+ * memory mapping so that other processes can read it while it grows.
+ *
+ * The file starts with a GstAubioLogHeader, followed by the records, in
+ * native byte order. Space is allocated ahead in steps of
+ * GST_AUBIO_LOG_GROW records; records is only increased once the records
+ * it covers are written, so readers should read it first and never look
+ * past it. The file is cut to the records written when it is closed. */
+
+/* header of a log file, at offset 0 */
+typedef struct
+{
+  guint32 magic;
+  guint32 version;
+  guint32 header_size;          /* offset of the first record */
+  guint32 record_size;
+  volatile gint records;        /* complete records that follow */
+  volatile gint streams;        /* streams started, the last stream id */
+  guint32 reserved[2];
+} GstAubioLogHeader;
+
+/* one result, stream tells the streams logged to the same file apart */
+typedef struct
+{
+  GstClockTime timestamp;       /* time of the analysed audio */
+  gfloat value;                 /* pitch in Hz, bpm for beats */
+  gfloat confidence;
+  guint32 stream;               /* id of the stream, from 1 */
+  guint16 channel;              /* analysed channel */
+  guint16 kind;                 /* a GstAubioResultKind */
+} GstAubioLogRecord;
+
+/* records the file grows by */
+#define GST_AUBIO_LOG_GROW 65536
+/* records between two asynchronous flushes of the mapping */
+#define GST_AUBIO_LOG_SYNC 4096
+
+typedef struct
+{
+  GMutex lock;
+  gint fd;                      /* -1 when closed */
+  GstAubioLogHeader *header;    /* start of the mapping */
+  gsize size;                   /* of the mapping */
+  guint capacity;               /* records the mapping holds */
+  guint stream;                 /* id of the current stream */
+  guint unsynced;               /* records since the last msync */
+} GstAubioLog;
+
+void gst_aubio_log_init (GstAubioLog * rlog);
+void gst_aubio_log_clear (GstAubioLog * rlog);
+
+/* open location for appending, a log already there is continued */
+gboolean gst_aubio_log_open (GstAubioLog * rlog, GstObject * element,
+    const gchar * location);
+void gst_aubio_log_close (GstAubioLog * rlog);
+
+/* number the records that follow as a new stream */
+void gst_aubio_log_new_stream (GstAubioLog * rlog);
+void gst_aubio_log_append (GstAubioLog * rlog, const GstAubioResult * result);
+
+static inline gboolean
+gst_aubio_log_is_open (GstAubioLog * rlog)
+{
+  return rlog->fd != -1;
+}
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_LOG_H__ */
@@ -0,0 +1,175 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "gstaubiomedian.h"
+
+/* values ranked above and below the median */
+#define ABOVE(m) (((m)->count - 1) / 2)
+#define BELOW(m) ((m)->count / 2)
+
+GstAubioMedian *
+gst_aubio_median_new (guint size)
+{
+  GstAubioMedian *median = g_new0 (GstAubioMedian, 1);
+
+  median->size = MAX (size, 1);
+  median->values = g_new0 (gfloat, median->size);
+  median->pos = g_new0 (gint, median->size);
+  median->ranks = g_new0 (gint, median->size);
+  median->heap = median->ranks + median->size / 2;
+  gst_aubio_median_reset (median);
+
+  return median;
+}
+
+void
+gst_aubio_median_free (GstAubioMedian * median)
+{
+  g_free (median->values);
+  g_free (median->pos);
+  g_free (median->ranks);
+  g_free (median);
+}
+
+void
+gst_aubio_median_reset (GstAubioMedian * median)
+{
+  gint i;
+
+  median->next = 0;
+  median->count = 0;
+  /* fill in the order median, below, above, below, ... so that the heaps
+   * grow evenly while the window fills up */
+  for (i = 0; i < median->size; i++) {
+    median->pos[i] = ((i + 1) / 2) * ((i & 1) ? -1 : 1);
+    median->heap[median->pos[i]] = i;
+  }
+}
+
+static inline gboolean
+gst_aubio_median_less (GstAubioMedian * m, gint i, gint j)
+{
+  return m->values[m->heap[i]] < m->values[m->heap[j]];
+}
+
+/* swap ranks i and j when the value at i is less than the one at j */
+static gboolean
+gst_aubio_median_order (GstAubioMedian * m, gint i, gint j)
+{
+  gint t;
+
+  if (!gst_aubio_median_less (m, i, j))
+    return FALSE;
+
+  t = m->heap[i];
+  m->heap[i] = m->heap[j];
+  m->heap[j] = t;
+  m->pos[m->heap[i]] = i;
+  m->pos[m->heap[j]] = j;
+  return TRUE;
+}
+
+/* restore the min heap from rank i down, i being the first child of the
+ * rank whose value grew */
+static void
+gst_aubio_median_sift_down_above (GstAubioMedian * m, gint i)
+{
+  for (; i <= ABOVE (m); i *= 2) {
+    /* 1 is the only child of the median on this side */
+    if (i > 1 && i < ABOVE (m) && gst_aubio_median_less (m, i + 1, i))
+      i++;
+    if (!gst_aubio_median_order (m, i, i / 2))
+      break;
+  }
+}
+
+/* restore the max heap from rank i down, i being the first child of the
+ * rank whose value shrank */
+static void
+gst_aubio_median_sift_down_below (GstAubioMedian * m, gint i)
+{
+  for (; i >= -BELOW (m); i *= 2) {
+    if (i < -1 && i > -BELOW (m) && gst_aubio_median_less (m, i, i - 1))
+      i--;
+    if (!gst_aubio_median_order (m, i / 2, i))
+      break;
+  }
+}
+
+/* move the value at rank i up the min heap, TRUE when it became the
+ * median */
+static gboolean
+gst_aubio_median_sift_up_above (GstAubioMedian * m, gint i)
+{
+  while (i > 0 && gst_aubio_median_order (m, i, i / 2))
+    i /= 2;
+  return i == 0;
+}
+
+/* move the value at rank i up the max heap, TRUE when it became the
+ * median */
+static gboolean
+gst_aubio_median_sift_up_below (GstAubioMedian * m, gint i)
+{
+  while (i < 0 && gst_aubio_median_order (m, i / 2, i))
+    i /= 2;
+  return i == 0;
+}
+
+gfloat
+gst_aubio_median_push (GstAubioMedian * m, gfloat value)
+{
+  gboolean full = m->count == m->size;
+  gint p = m->pos[m->next];
+  gfloat old = m->values[m->next];
+
+  m->values[m->next] = value;
+  m->next = (m->next + 1) % m->size;
+  if (!full)
+    m->count++;
+
+  if (p > 0) {
+    /* above the median */
+    if (full && old < value)
+      gst_aubio_median_sift_down_above (m, p * 2);
+    else if (gst_aubio_median_sift_up_above (m, p))
+      gst_aubio_median_sift_down_below (m, -1);
+  } else if (p < 0) {
+    /* below the median */
+    if (full && value < old)
+      gst_aubio_median_sift_down_below (m, p * 2);
+    else if (gst_aubio_median_sift_up_below (m, p))
+      gst_aubio_median_sift_down_above (m, 1);
+  } else {
+    /* the median itself */
+    if (BELOW (m))
+      gst_aubio_median_sift_down_below (m, -1);
+    if (ABOVE (m))
+      gst_aubio_median_sift_down_above (m, 1);
+  }
+
+  return m->values[m->heap[0]];
+}
@@ -0,0 +1,61 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GST_AUBIO_MEDIAN_H__
+#define __GST_AUBIO_MEDIAN_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Running median of the last size values pushed, updated in O(log size)
+ * per value.
+ *
+ * The values of the window are ranked in a single array of heaps centred
+ * on the median: heap[0] is the median, the negative indices a max heap of
+ * the values below it and the positive ones a min heap of the values above
+ * it, the children of i being 2i and 2i+1 (or 2i-1 below). Each new value
+ * takes the slot of the oldest one and is sifted from its position, so
+ * there is no search and no removal. */
+typedef struct
+{
+  gfloat *values;       /* the window, circular, in arrival order */
+  gint *pos;            /* rank position of each slot of values */
+  gint *ranks;          /* storage of heap */
+  gint *heap;           /* slots of values by rank, median at 0 */
+  gint size;
+  gint next;            /* slot the next value goes to */
+  gint count;           /* values in the window, up to size */
+} GstAubioMedian;
+
+GstAubioMedian * gst_aubio_median_new (guint size);
+void gst_aubio_median_free (GstAubioMedian * median);
+
+/* empty the window */
+void gst_aubio_median_reset (GstAubioMedian * median);
+/* add value in place of the oldest one once the window is full, and
+ * return the median of the window; the upper one for even counts */
+gfloat gst_aubio_median_push (GstAubioMedian * median, gfloat value);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_MEDIAN_H__ */
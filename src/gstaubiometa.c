@@ -0,0 +1,157 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstaubiometa.h"
+
+/* a copy of the n bytes at data, g_memdup being deprecated */
+static gpointer
+gst_aubio_meta_dup (gconstpointer data, gsize n)
+{
+  gpointer copy;
+
+  if (data == NULL || n == 0)
+    return NULL;
+
+  copy = g_malloc (n);
+  memcpy (copy, data, n);
+
+  return copy;
+}
+
+GType
+gst_aubio_analysis_meta_api_get_type (void)
+{
+  static volatile GType type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType t = gst_meta_api_type_register ("GstAubioAnalysisMetaAPI",
+        tags);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+static gboolean
+gst_aubio_analysis_meta_init (GstMeta * meta, gpointer params,
+    GstBuffer * buffer)
+{
+  GstAubioAnalysisMeta *ameta = (GstAubioAnalysisMeta *) meta;
+
+  ameta->channels = 0;
+  ameta->pitches = NULL;
+  ameta->n_pitches = 0;
+  ameta->beats = NULL;
+  ameta->beat_channels = NULL;
+  ameta->n_beats = 0;
+  ameta->bpm = NULL;
+
+  return TRUE;
+}
+
+static void
+gst_aubio_analysis_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstAubioAnalysisMeta *ameta = (GstAubioAnalysisMeta *) meta;
+
+  g_free (ameta->pitches);
+  g_free (ameta->beats);
+  g_free (ameta->beat_channels);
+  g_free (ameta->bpm);
+}
+
+/* the results describe the whole buffer, only plain copies keep them */
+static gboolean
+gst_aubio_analysis_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstAubioAnalysisMeta *ameta = (GstAubioAnalysisMeta *) meta;
+  GstMetaTransformCopy *copy = data;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type) || copy->region)
+    return FALSE;
+
+  if (ameta->bpm != NULL) {
+    gst_buffer_add_aubio_tempo_analysis_meta (dest, ameta->channels,
+        ameta->beats, ameta->beat_channels, ameta->n_beats, ameta->bpm);
+  } else {
+    gst_buffer_add_aubio_pitch_analysis_meta (dest, ameta->channels,
+        ameta->pitches, ameta->n_pitches);
+  }
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_aubio_analysis_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *meta = gst_meta_register (
+        GST_AUBIO_ANALYSIS_META_API_TYPE, "GstAubioAnalysisMeta",
+        sizeof (GstAubioAnalysisMeta), gst_aubio_analysis_meta_init,
+        gst_aubio_analysis_meta_free, gst_aubio_analysis_meta_transform);
+    g_once_init_leave (&info, meta);
+  }
+  return info;
+}
+
+GstAubioAnalysisMeta *
+gst_buffer_add_aubio_pitch_analysis_meta (GstBuffer * buffer,
+    guint channels, const gfloat * pitches, guint n)
+{
+  GstAubioAnalysisMeta *meta;
+
+  meta = (GstAubioAnalysisMeta *) gst_buffer_add_meta (buffer,
+      GST_AUBIO_ANALYSIS_META_INFO, NULL);
+  meta->channels = channels;
+  meta->pitches = gst_aubio_meta_dup (pitches, n * sizeof (gfloat));
+  meta->n_pitches = n;
+
+  return meta;
+}
+
+GstAubioAnalysisMeta *
+gst_buffer_add_aubio_tempo_analysis_meta (GstBuffer * buffer,
+    guint channels, const gint64 * beats, const guint * beat_channels,
+    guint n, const gdouble * bpm)
+{
+  GstAubioAnalysisMeta *meta;
+
+  meta = (GstAubioAnalysisMeta *) gst_buffer_add_meta (buffer,
+      GST_AUBIO_ANALYSIS_META_INFO, NULL);
+  meta->channels = channels;
+  meta->beats = gst_aubio_meta_dup (beats, n * sizeof (gint64));
+  meta->beat_channels = gst_aubio_meta_dup (beat_channels,
+      n * sizeof (guint));
+  meta->n_beats = n;
+  meta->bpm = gst_aubio_meta_dup (bpm, channels * sizeof (gdouble));
+
+  return meta;
+}
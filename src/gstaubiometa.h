@@ -0,0 +1,72 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GST_AUBIO_META_H__
+#define __GST_AUBIO_META_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_AUBIO_ANALYSIS_META_API_TYPE \
+    (gst_aubio_analysis_meta_api_get_type ())
+#define GST_AUBIO_ANALYSIS_META_INFO (gst_aubio_analysis_meta_get_info ())
+
+/* Results found in an audio buffer, attached to it by aubiopitch and
+ * aubiotempo when attach-analysis is set. Applications that do not build
+ * against this header look the API type up by its name,
+ * "GstAubioAnalysisMetaAPI". */
+typedef struct
+{
+  GstMeta meta;
+
+  guint channels;               /* analysed channels */
+
+  /* aubiopitch: channels pitches in Hz per hop, 0 when unvoiced */
+  gfloat *pitches;
+  guint n_pitches;
+
+  /* aubiotempo: beat positions in frames from the start of the buffer,
+   * negative when the beat fell in an earlier buffer, the channel of
+   * each, and the current tempo of each channel, NULL for aubiopitch */
+  gint64 *beats;
+  guint *beat_channels;
+  guint n_beats;
+  gdouble *bpm;
+} GstAubioAnalysisMeta;
+
+GType gst_aubio_analysis_meta_api_get_type (void);
+const GstMetaInfo * gst_aubio_analysis_meta_get_info (void);
+
+#define gst_buffer_get_aubio_analysis_meta(b) ((GstAubioAnalysisMeta *) \
+    gst_buffer_get_meta ((b), GST_AUBIO_ANALYSIS_META_API_TYPE))
+
+/* the arrays are copied into the meta */
+GstAubioAnalysisMeta * gst_buffer_add_aubio_pitch_analysis_meta (
+    GstBuffer * buffer, guint channels, const gfloat * pitches, guint n);
+GstAubioAnalysisMeta * gst_buffer_add_aubio_tempo_analysis_meta (
+    GstBuffer * buffer, guint channels, const gint64 * beats,
+    const guint * beat_channels, guint n, const gdouble * bpm);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_META_H__ */
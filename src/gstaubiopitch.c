@@ -26,8 +26,8 @@
  * <title>Example launch line</title>
  * <para>
  * <programlisting>
- * gst-launch -v -m audiotestsrc ! aubiopitch ! fakesink
- * gst-launch filesrc location=audiofile ! decodebin ! audioconvert ! \
+ * gst-launch-1.0 -v -m audiotestsrc ! aubiopitch ! fakesink
+ * gst-launch-1.0 filesrc location=audiofile ! decodebin ! audioconvert ! \
  *      aubiopitch silent=FALSE ! audioconvert ! autoaudiosink
  * </programlisting>
  * </para>
@@ -38,84 +38,192 @@
 #  include <config.h>
 #endif
 
+#include <math.h>
+#include <string.h>
+
 #include <gst/gst.h>
 #include <gst/audio/audio.h>
 
 #include "gstaubiopitch.h"
+#include "gstaubiocache.h"
+#include "gstaubiometa.h"
 
 GST_DEBUG_CATEGORY_STATIC(aubiopitch_debug);
 #define GST_CAT_DEFAULT aubiopitch_debug
 
-static const GstElementDetails element_details = 
-GST_ELEMENT_DETAILS ("Aubio Pitch Analysis",
-  "Filter/Analyzer/Audio",
-  "Extract pitch using aubio",
-  "Paul Brossier <piem@aubio.org>");
-
 /* Filter signals and args */
 enum
 {
-  /* FILL ME */
+  SIGNAL_PULL_RESULTS,
   LAST_SIGNAL
 };
 
 enum
 {
   PROP_0,
-  PROP_SILENT
+  PROP_SILENT,
+  PROP_DOWNMIX,
+  PROP_MESSAGE,
+  PROP_MESSAGE_HOPS,
+  PROP_MESSAGE_INTERVAL,
+  PROP_ATTACH_ANALYSIS,
+  PROP_ASYNC,
+  PROP_QUEUE_SIZE,
+  PROP_QUEUE_POLICY,
+  PROP_SHARED_POOL,
+  PROP_METHOD,
+  PROP_BUF_SIZE,
+  PROP_HOP_SIZE,
+  PROP_TOLERANCE,
+  PROP_SILENCE,
+  PROP_GATE,
+  PROP_GATE_THRESHOLD,
+  PROP_GATE_HANGOVER,
+  PROP_DEGRADE,
+  PROP_DECIMATION,
+  PROP_LOW_LATENCY,
+  PROP_LATENCY,
+  PROP_STATS,
+  PROP_COLLECT_STATS,
+  PROP_CACHE_LOCATION,
+  PROP_LOG_LOCATION,
+  PROP_RING_SIZE,
+  PROP_MEDIAN_WINDOW,
+  PROP_EMIT,
+  PROP_EMIT_CENTS
 };
 
-#define ALLOWED_CAPS \
-    "audio/x-raw-float,"                                              \
-    " width=(int)32,"                                                 \
-    " endianness=(int)BYTE_ORDER,"                                    \
-    " rate=(int)44100,"                                               \
-    " channels=(int)1"
+#define DEFAULT_MESSAGE_HOPS 0
+#define DEFAULT_MESSAGE_INTERVAL (100 * GST_MSECOND)
+#define DEFAULT_QUEUE_SIZE 64
+#define DEFAULT_QUEUE_POLICY GST_AUBIO_QUEUE_BLOCK
+#define DEFAULT_RING_SIZE 0
+
+/* window and hop sizes at GST_AUBIO_REFERENCE_RATE, scaled to the
+ * negotiated rate in setup */
+#define DEFAULT_BUF_SIZE 2048
+#define DEFAULT_HOP_SIZE 256
+/* smallest window still holding two periods of a low voice, and hop */
+#define LOW_LATENCY_BUF_SIZE 1024
+#define LOW_LATENCY_HOP_SIZE 64
+
+#define DEFAULT_METHOD "yinfft"
+#define DEFAULT_TOLERANCE 0.7
+#define DEFAULT_SILENCE -50.
+#define DEFAULT_DECIMATION 1
+#define DEFAULT_MEDIAN_WINDOW 1
+#define MAX_MEDIAN_WINDOW 255
+#define DEFAULT_EMIT GST_AUBIO_PITCH_EMIT_HOP
+#define DEFAULT_EMIT_CENTS 50.
+
+#define DEFAULT_GATE_THRESHOLD -70.
+#define DEFAULT_GATE_HANGOVER 8
+
+/* pending changes of the analysis settings */
+#define RECONFIGURE_TUNE  (1 << 0)  /* tolerance or silence threshold */
+#define RECONFIGURE_BUILD (1 << 1)  /* method or sizes, needs new detectors */
+
+#define ALLOWED_CAPS                                                  \
+    GST_AUDIO_CAPS_MAKE ("{ " GST_AUDIO_NE (F32) ", "                 \
+        GST_AUDIO_NE (F64) ", " GST_AUDIO_NE (S16) ", "               \
+        GST_AUDIO_NE (S32) " }")                                      \
+    ", layout=(string)interleaved"
 
-GST_BOILERPLATE (GstAubioPitch, gst_aubio_pitch, GstAudioFilter,
-    GST_TYPE_AUDIO_FILTER);
+static GstStaticPadTemplate results_template =
+GST_STATIC_PAD_TEMPLATE ("results",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("application/x-aubio-pitch"));
+
+#define gst_aubio_pitch_parent_class parent_class
+G_DEFINE_TYPE (GstAubioPitch, gst_aubio_pitch, GST_TYPE_AUDIO_FILTER);
+
+static guint gst_aubio_pitch_signals[LAST_SIGNAL] = { 0 };
 
 static void gst_aubio_pitch_finalize (GObject * obj);
 static void gst_aubio_pitch_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_aubio_pitch_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static GstBuffer *gst_aubio_pitch_pull_results (GstAubioPitch * filter);
 
+static gboolean gst_aubio_pitch_setup (GstAudioFilter * audiofilter,
+        const GstAudioInfo * info);
+static gboolean gst_aubio_pitch_stop (GstBaseTransform * trans);
+static gboolean gst_aubio_pitch_sink_event (GstBaseTransform * trans,
+        GstEvent * event);
+static gboolean gst_aubio_pitch_src_event (GstBaseTransform * trans,
+        GstEvent * event);
 static GstFlowReturn gst_aubio_pitch_transform_ip (GstBaseTransform * trans,
         GstBuffer * buf);
 
-/* GObject vmethod implementations */
-static void
-gst_aubio_pitch_base_init (gpointer gclass)
-{
-  GstElementClass *element_class = GST_ELEMENT_CLASS (gclass);
+static GstPad *gst_aubio_pitch_request_new_pad (GstElement * element,
+        GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_aubio_pitch_release_pad (GstElement * element, GstPad * pad);
 
-  GstCaps *caps;
+static void gst_aubio_pitch_flush_batch (GstAubioPitch * filter);
+static void gst_aubio_pitch_drain_hop (GstAubioPitch * filter);
+static void gst_aubio_pitch_end_chunk (GstAubioPitch * filter);
+static void gst_aubio_pitch_start_cache (GstAubioPitch * filter);
+static gboolean gst_aubio_pitch_start_log (GstAubioPitch * filter);
+static void gst_aubio_pitch_worker_func (GstAubioHop * hop,
+        gpointer user_data);
 
-  caps = gst_caps_from_string (ALLOWED_CAPS);
-
-  gst_audio_filter_class_add_pad_templates (GST_AUDIO_FILTER_CLASS (gclass),
-        caps);
-
-  gst_caps_unref (caps);
-
-  gst_element_class_set_details (element_class, &element_details);
+GType
+gst_aubio_pitch_emit_get_type (void)
+{
+  static volatile gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_AUBIO_PITCH_EMIT_HOP, "Report the pitch of every hop", "hop"},
+    {GST_AUBIO_PITCH_EMIT_CHANGE, "Report the pitch when it changes",
+        "change"},
+    {0, NULL, NULL}
+  };
 
+  if (g_once_init_enter (&type)) {
+    GType t = g_enum_register_static ("GstAubioPitchEmit", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
 }
 
+/* GObject vmethod implementations */
+
 /* initialize the plugin's class */
 static void
 gst_aubio_pitch_class_init (GstAubioPitchClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
   GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
-  //GstAudioFilterClass *filter_class = GST_AUDIO_FILTER_CLASS (klass);
+  GstAudioFilterClass *filter_class = GST_AUDIO_FILTER_CLASS (klass);
+  GstCaps *caps;
+
+  caps = gst_caps_from_string (ALLOWED_CAPS);
+  gst_audio_filter_class_add_pad_templates (filter_class, caps);
+  gst_caps_unref (caps);
+
+  gst_element_class_add_static_pad_template (element_class,
+      &results_template);
 
-  //trans_class->stop = GST_DEBUG_FUNCPTR (gst_aubio_pitch_stop);
-  //trans_class->event = GST_DEBUG_FUNCPTR (gst_aubio_pitch_event);
+  gst_element_class_set_static_metadata (element_class,
+      "Aubio Pitch Analysis",
+      "Filter/Analyzer/Audio",
+      "Extract pitch using aubio",
+      "Paul Brossier <piem@aubio.org>");
+
+  filter_class->setup = GST_DEBUG_FUNCPTR (gst_aubio_pitch_setup);
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_aubio_pitch_stop);
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_aubio_pitch_sink_event);
+  trans_class->src_event = GST_DEBUG_FUNCPTR (gst_aubio_pitch_src_event);
   trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_aubio_pitch_transform_ip);
   trans_class->passthrough_on_same_caps = TRUE;
 
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_aubio_pitch_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_aubio_pitch_release_pad);
+
   gobject_class->finalize = gst_aubio_pitch_finalize;
   gobject_class->set_property = gst_aubio_pitch_set_property;
   gobject_class->get_property = gst_aubio_pitch_get_property;
@@ -124,41 +232,668 @@ gst_aubio_pitch_class_init (GstAubioPitchClass * klass)
       g_param_spec_boolean ("silent", "Silent", "Produce verbose output",
           TRUE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_DOWNMIX,
+      g_param_spec_boolean ("downmix", "Downmix",
+          "Analyse the average of all channels instead of each channel",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_MESSAGE,
+      g_param_spec_boolean ("message", "Message",
+          "Emit gstreamer messages with batches of pitch results",
+          FALSE, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_MESSAGE_HOPS,
+      g_param_spec_uint ("message-hops", "Message hops",
+          "Post a message at least every this many hops (0 = no limit)",
+          0, G_MAXUINT, DEFAULT_MESSAGE_HOPS, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_MESSAGE_INTERVAL,
+      g_param_spec_uint64 ("message-interval", "Message interval",
+          "Post a message at least every this many nanoseconds of audio",
+          1, G_MAXUINT64, DEFAULT_MESSAGE_INTERVAL, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_ATTACH_ANALYSIS,
+      g_param_spec_boolean ("attach-analysis", "Attach analysis",
+          "Attach the pitches found in each buffer to it as a "
+          "GstAubioAnalysisMeta, not with async=TRUE", FALSE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_ASYNC,
+      g_param_spec_boolean ("async", "Async",
+          "Analyse on a worker thread instead of the streaming thread",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_QUEUE_SIZE,
+      g_param_spec_uint ("queue-size", "Queue size",
+          "Number of hops the worker thread can lag behind in async mode",
+          1, G_MAXUINT, DEFAULT_QUEUE_SIZE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_QUEUE_POLICY,
+      g_param_spec_enum ("queue-policy", "Queue policy",
+          "What to do with new hops when the async queue is full",
+          GST_TYPE_AUBIO_QUEUE_POLICY, DEFAULT_QUEUE_POLICY,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SHARED_POOL,
+      g_param_spec_boolean ("shared-pool", "Shared pool",
+          "In async mode, analyse on the thread pool shared by all aubio "
+          "elements instead of a thread of our own (the pool size is set "
+          "with the " GST_AUBIO_THREADS_ENV " environment variable)",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_METHOD,
+      g_param_spec_string ("method", "Method",
+          "Pitch detection method (yinfft, yin, mcomb, fcomb, schmitt)",
+          DEFAULT_METHOD, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_BUF_SIZE,
+      g_param_spec_uint ("buf-size", "Buffer size",
+          "Analysis window in frames (0 = scale 2048 at 44100 Hz to the rate)",
+          0, G_MAXINT, 0, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_HOP_SIZE,
+      g_param_spec_uint ("hop-size", "Hop size",
+          "Frames between two analyses (0 = scale 256 at 44100 Hz to the rate)",
+          0, G_MAXINT, 0, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_TOLERANCE,
+      g_param_spec_float ("tolerance", "Tolerance",
+          "Tolerance of the pitch detection method",
+          0., 1., DEFAULT_TOLERANCE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_SILENCE,
+      g_param_spec_float ("silence", "Silence",
+          "Level in dB below which no pitch is reported",
+          -200., 0., DEFAULT_SILENCE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_GATE,
+      g_param_spec_boolean ("gate", "Gate",
+          "Skip the analysis of hops quieter than gate-threshold",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_GATE_THRESHOLD,
+      g_param_spec_float ("gate-threshold", "Gate threshold",
+          "RMS level in dB below which hops are reported as unvoiced",
+          -200., 0., DEFAULT_GATE_THRESHOLD,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_GATE_HANGOVER,
+      g_param_spec_uint ("gate-hangover", "Gate hangover",
+          "Number of hops still analysed after the level drops below "
+          "gate-threshold", 0, G_MAXUINT, DEFAULT_GATE_HANGOVER,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_DEGRADE,
+      g_param_spec_boolean ("degrade", "Degrade",
+          "Analyse on longer hops while the analysis cannot keep up with "
+          "the stream, posting an " GST_AUBIO_QUALITY_NAME " message at each "
+          "change", FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_DECIMATION,
+      g_param_spec_uint ("decimation", "Decimation",
+          "Low-pass and downsample the signal by this factor (1, 2, 4 or 8) "
+          "before detecting its pitch, buf-size and hop-size are then at "
+          "the decimated rate", 1, 8, DEFAULT_DECIMATION,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_LOW_LATENCY,
+      g_param_spec_boolean ("low-latency", "Low latency",
+          "Default to the smallest usable window and hop, and push results "
+          "after every hop instead of every buffer",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_MEDIAN_WINDOW,
+      g_param_spec_uint ("median-window", "Median window",
+          "Report the median of the pitches of this many hops, unvoiced "
+          "ones included, delaying the results by half of it (1 = raw "
+          "pitches)", 1, MAX_MEDIAN_WINDOW, DEFAULT_MEDIAN_WINDOW,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_EMIT,
+      g_param_spec_enum ("emit", "Emit",
+          "Which pitches to report on every output",
+          GST_TYPE_AUBIO_PITCH_EMIT, DEFAULT_EMIT,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_EMIT_CENTS,
+      g_param_spec_float ("emit-cents", "Emit cents",
+          "With emit=change, smallest move in cents from the last pitch "
+          "reported to report a new one", 0., 2400., DEFAULT_EMIT_CENTS,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY,
+      g_param_spec_uint64 ("latency", "Latency",
+          "Delay in nanoseconds between the analysed audio and the end of "
+          "the hop its result is available at, median-window included",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Hops analysed, results, time spent in the detector, bytes "
+          "received and hops dropped while collect-stats is TRUE",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_COLLECT_STATS,
+      g_param_spec_boolean ("collect-stats", "Collect statistics",
+          "Update the counters of the stats property", FALSE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_CACHE_LOCATION,
+      g_param_spec_string ("cache-location", "Cache location",
+          "Directory of the results of audio analysed before, replayed "
+          "instead of analysing the same audio again (NULL = no cache)",
+          NULL, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_LOG_LOCATION,
+      g_param_spec_string ("log-location", "Log location",
+          "File the results are appended to as binary records, readable "
+          "while it is written (NULL = no log)",
+          NULL, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring size",
+          "Number of results kept for the pull-results action signal, "
+          "rounded up to a power of two, newer results are dropped when "
+          "it is full (0 = no ring)", 0, GST_AUBIO_RING_MAX_SIZE,
+          DEFAULT_RING_SIZE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstAubioPitch::pull-results:
+   *
+   * Takes all the results kept since the last call, as a buffer of packed
+   * GstAubioResult records in the order they were found, or NULL when
+   * there are none. Can be emitted from any thread, needs ring-size.
+   */
+  gst_aubio_pitch_signals[SIGNAL_PULL_RESULTS] =
+      g_signal_new ("pull-results", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstAubioPitchClass, pull_results), NULL, NULL, NULL,
+      GST_TYPE_BUFFER, 0, G_TYPE_NONE);
+
+  klass->pull_results = gst_aubio_pitch_pull_results;
+
   GST_DEBUG_CATEGORY_INIT (aubiopitch_debug, "aubiopitch", 0,
           "Aubio pitch extraction");
 
 }
 
 static void
-gst_aubio_pitch_init (GstAubioPitch * filter,
-    GstAubioPitchClass * gclass)
+gst_aubio_pitch_init (GstAubioPitch * filter)
 {
 
   filter->silent = TRUE;
+  filter->downmix = FALSE;
+  filter->message = FALSE;
+  filter->message_hops = DEFAULT_MESSAGE_HOPS;
+  filter->message_interval = DEFAULT_MESSAGE_INTERVAL;
+
+  filter->batch = NULL;
+  filter->batch_size = 0;
+  filter->batch_len = 0;
+  filter->batch_hops = 0;
+
+  filter->attach_analysis = FALSE;
+  filter->analysis = g_array_new (FALSE, FALSE, sizeof (gfloat));
+
+  filter->async = FALSE;
+  filter->queue_size = DEFAULT_QUEUE_SIZE;
+  filter->queue_policy = DEFAULT_QUEUE_POLICY;
+  filter->shared_pool = FALSE;
+  filter->worker = NULL;
+
+  filter->method = g_strdup (DEFAULT_METHOD);
+  filter->conf_buf_size = 0;
+  filter->conf_hop_size = 0;
+  filter->tolerance = DEFAULT_TOLERANCE;
+  filter->silence_threshold = DEFAULT_SILENCE;
+  filter->decimation = DEFAULT_DECIMATION;
+  filter->low_latency = FALSE;
+  filter->median_window = DEFAULT_MEDIAN_WINDOW;
+  filter->reconfigure = 0;
+
+  filter->gate = FALSE;
+  filter->gate_threshold = DEFAULT_GATE_THRESHOLD;
+  filter->gate_hangover = DEFAULT_GATE_HANGOVER;
+  filter->gate_hold = NULL;
+  filter->stale = NULL;
+
+  filter->emit = DEFAULT_EMIT;
+  filter->emit_cents = DEFAULT_EMIT_CENTS;
+  filter->median = NULL;
+  filter->last_pitch = NULL;
+
+  filter->degrade = FALSE;
+  gst_aubio_qos_reset (&filter->qos, GST_ELEMENT (filter));
+  gst_aubio_stats_init (&filter->stats);
 
-  filter->buf_size = 2048;
-  filter->hop_size = 256;
-  filter->samplerate = 44100;
-  filter->channels = 1;
+  filter->cache_location = NULL;
+  gst_aubio_disk_cache_init (&filter->disk_cache);
 
-  filter->ibuf = new_fvec(filter->hop_size);
+  filter->log_location = NULL;
+  gst_aubio_log_init (&filter->result_log);
+
+  filter->ring_size = DEFAULT_RING_SIZE;
+  gst_aubio_ring_init (&filter->ring);
+
+  filter->buf_size = DEFAULT_BUF_SIZE;
+  filter->hop_size = DEFAULT_HOP_SIZE;
+  filter->in_hop_size = DEFAULT_HOP_SIZE;
+  filter->samplerate = GST_AUBIO_REFERENCE_RATE;
+  filter->latency = 0;
+
+  filter->resync = TRUE;
+  filter->fresh = FALSE;
+  filter->start_time = 0;
+  filter->frames = 0;
+
+  filter->dec = NULL;
+  filter->dbuf = NULL;
+  filter->factor = 1;
+
+  /* analysers are created in setup, once the channel count is known */
+  filter->channels = 0;
+  filter->t = NULL;
+  filter->t_method = NULL;
+  filter->ibuf = NULL;
   filter->obuf = new_fvec(1);
-  filter->t = new_aubio_pitch("yinfft", filter->buf_size, filter->hop_size,
+}
+
+static void
+gst_aubio_pitch_free_decimators (GstAubioPitch * filter)
+{
+  uint i;
+
+  if (filter->dec == NULL)
+    return;
+
+  for (i = 0; i < filter->channels; i++) {
+    gst_aubio_decimator_free (filter->dec[i]);
+    del_fvec (filter->dbuf[i]);
+  }
+  g_free (filter->dec);
+  g_free (filter->dbuf);
+
+  filter->dec = NULL;
+  filter->dbuf = NULL;
+  filter->factor = 1;
+}
+
+static void
+gst_aubio_pitch_free_smoothing (GstAubioPitch * filter)
+{
+  uint i;
+
+  if (filter->median) {
+    for (i = 0; i < filter->channels; i++)
+      gst_aubio_median_free (filter->median[i]);
+  }
+  g_free (filter->median);
+  g_free (filter->last_pitch);
+
+  filter->median = NULL;
+  filter->last_pitch = NULL;
+}
+
+static void
+gst_aubio_pitch_free_analysers (GstAubioPitch * filter)
+{
+  uint i;
+
+  if (filter->worker) {
+    gst_aubio_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+
+  for (i = 0; i < filter->channels; i++) {
+    if (filter->t[i]) {
+      gst_aubio_cache_put_pitch (filter->t[i], filter->t_method,
+          filter->buf_size, filter->hop_size, filter->t_rate);
+    }
+    if (filter->ibuf[i]) {
+      del_fvec(filter->ibuf[i]);
+    }
+  }
+  gst_aubio_pitch_free_decimators (filter);
+  gst_aubio_pitch_free_smoothing (filter);
+  g_free (filter->t);
+  g_free (filter->ibuf);
+  g_free (filter->gate_hold);
+  g_free (filter->stale);
+  g_free (filter->batch);
+
+  g_free (filter->t_method);
+  filter->t = NULL;
+  filter->t_method = NULL;
+  filter->ibuf = NULL;
+  filter->batch = NULL;
+  filter->batch_size = 0;
+  filter->batch_len = 0;
+  filter->batch_hops = 0;
+  filter->gate_hold = NULL;
+  filter->stale = NULL;
+  filter->channels = 0;
+}
+
+/* (re)create the detectors of the analysed channels from the current
+ * settings. On failure, the previous detectors are kept. */
+static gboolean
+gst_aubio_pitch_build (GstAubioPitch * filter, uint channels)
+{
+  aubio_pitch_t **t;
+  guint *stale;
+  gchar *method;
+  uint buf_size, hop_size, factor, rate, window;
+  gfloat tolerance, silence;
+  gboolean low_latency, restart;
+  GstClockTime latency;
+  uint i, kept;
+
+  GST_OBJECT_LOCK (filter);
+  method = g_strdup (filter->method);
+  buf_size = filter->conf_buf_size;
+  hop_size = filter->conf_hop_size;
+  tolerance = filter->tolerance;
+  silence = filter->silence_threshold;
+  factor = filter->decimation;
+  low_latency = filter->low_latency;
+  window = filter->median_window;
+  GST_OBJECT_UNLOCK (filter);
+
+  /* powers of two only, so that hops stay powers of two */
+  factor = factor >= 8 ? 8 : factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+  factor = MIN (factor, filter->samplerate);
+  rate = filter->samplerate / factor;
+
+  if (buf_size == 0)
+    buf_size = gst_aubio_scale_size (low_latency ? LOW_LATENCY_BUF_SIZE
+        : DEFAULT_BUF_SIZE, rate);
+  if (hop_size == 0)
+    hop_size = gst_aubio_scale_size (low_latency ? LOW_LATENCY_HOP_SIZE
+        : DEFAULT_HOP_SIZE, rate);
+  /* degraded analysis runs on longer hops, with the same window */
+  if (filter->degrade)
+    hop_size = gst_aubio_qos_hop_size (&filter->qos, hop_size, buf_size);
+
+  /* with the same detector settings, as on a reset, the current detectors
+   * are kept. Kept and reused detectors are not cleared, which would take
+   * a window of detector passes on silence: the window is refilled by the
+   * audio instead, and the pitch of these hops is not reported */
+  kept = 0;
+  if (filter->t_method != NULL && g_str_equal (method, filter->t_method)
+      && buf_size == filter->buf_size && hop_size == filter->hop_size
+      && rate == filter->t_rate)
+    kept = MIN (channels, filter->channels);
+
+  t = g_new0 (aubio_pitch_t *, channels);
+  stale = g_new0 (guint, channels);
+  for (i = 0; i < channels; i++) {
+    gboolean reused = TRUE;
+
+    if (i >= kept)
+      t[i] = gst_aubio_cache_get_pitch (method, buf_size, hop_size, rate,
+          &reused);
+    if (i >= kept && t[i] == NULL) {
+      GST_WARNING_OBJECT (filter, "could not create %s pitch detector, "
+          "buf_size %u, hop_size %u", method, buf_size, hop_size);
+      while (i-- > kept)
+        gst_aubio_cache_put_pitch (t[i], method, buf_size, hop_size, rate);
+      g_free (stale);
+      g_free (t);
+      g_free (method);
+      return FALSE;
+    }
+    if (reused)
+      stale[i] = (buf_size + hop_size - 1) / hop_size - 1;
+  }
+
+  /* let the worker finish the hops queued with the previous detectors */
+  restart = filter->worker != NULL;
+  if (filter->worker) {
+    gst_aubio_worker_drain (filter->worker);
+    gst_aubio_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+  gst_aubio_pitch_flush_batch (filter);
+
+  for (i = 0; i < kept; i++) {
+    t[i] = filter->t[i];
+    filter->t[i] = NULL;
+  }
+  for (i = 0; i < channels; i++) {
+    aubio_pitch_set_tolerance (t[i], tolerance);
+    aubio_pitch_set_silence (t[i], silence);
+  }
+
+  gst_aubio_pitch_free_decimators (filter);
+  gst_aubio_pitch_free_smoothing (filter);
+  for (i = 0; i < filter->channels; i++) {
+    gst_aubio_cache_put_pitch (filter->t[i], filter->t_method,
+        filter->buf_size, filter->hop_size, filter->t_rate);
+    del_fvec (filter->ibuf[i]);
+  }
+  g_free (filter->t);
+  g_free (filter->t_method);
+  g_free (filter->ibuf);
+  g_free (filter->gate_hold);
+  g_free (filter->stale);
+  g_free (filter->batch);
+
+  filter->t = t;
+  filter->t_method = method;
+  filter->t_rate = rate;
+  filter->ibuf = g_new0 (fvec_t *, channels);
+  filter->gate_hold = g_new0 (guint, channels);
+  filter->stale = stale;
+  filter->channels = channels;
+  filter->buf_size = buf_size;
+  filter->hop_size = hop_size;
+  filter->factor = factor;
+  filter->in_hop_size = hop_size * factor;
+  filter->pos = 0;
+
+  for (i = 0; i < channels; i++) {
+    filter->ibuf[i] = new_fvec(filter->in_hop_size);
+  }
+
+  filter->last_pitch = g_new (gfloat, channels);
+  for (i = 0; i < channels; i++) {
+    filter->last_pitch[i] = -1.;
+  }
+  if (window > 1) {
+    filter->median = g_new0 (GstAubioMedian *, channels);
+    for (i = 0; i < channels; i++) {
+      filter->median[i] = gst_aubio_median_new (window);
+    }
+  }
+
+  /* results describe the middle of the analysis window, which ends on the
+   * last sample of the hop, delayed by the decimator if any */
+  latency = GST_FRAMES_TO_CLOCK_TIME (buf_size / 2, rate);
+
+  if (factor > 1) {
+    filter->dec = g_new0 (GstAubioDecimator *, channels);
+    filter->dbuf = g_new0 (fvec_t *, channels);
+    for (i = 0; i < channels; i++) {
+      filter->dec[i] = gst_aubio_decimator_new (factor);
+      filter->dbuf[i] = new_fvec (filter->hop_size);
+    }
+    latency += GST_FRAMES_TO_CLOCK_TIME (
+        gst_aubio_decimator_delay (filter->dec[0]), filter->samplerate);
+  }
+
+  /* the median is that of the middle of its window, half a hop between
+   * two hops for even windows */
+  latency += GST_FRAMES_TO_CLOCK_TIME ((window - 1) * filter->in_hop_size / 2,
       filter->samplerate);
-  aubio_pitch_set_tolerance(filter->t, 0.7);
+
+  filter->latency = latency;
+  gst_aubio_results_pad_set_latency (&filter->results, GST_ELEMENT (filter),
+      latency);
+
+  /* room for one batch of results: a message interval worth of hops,
+   * bounded by message-hops, for each analysed channel */
+  filter->batch_size = gst_util_uint64_scale_ceil (filter->message_interval,
+      filter->samplerate, GST_SECOND * filter->in_hop_size) + 1;
+  if (filter->message_hops > 0)
+    filter->batch_size = MIN (filter->batch_size, filter->message_hops);
+  filter->batch_size *= filter->channels;
+  filter->batch = g_new (GstAubioResult, filter->batch_size);
+  filter->batch_len = 0;
+  filter->batch_hops = 0;
+
+  if (restart) {
+    filter->worker = gst_aubio_worker_new ("aubiopitch", filter->queue_size,
+        filter->channels, filter->hop_size, filter->shared_pool,
+        gst_aubio_pitch_worker_func, filter);
+  }
+
+  filter->fresh = TRUE;
+
+  GST_DEBUG_OBJECT (filter, "%s on %u channels at %u Hz, "
+      "buf_size %u, hop_size %u", method, filter->channels,
+      rate, filter->buf_size, filter->hop_size);
+
+  return TRUE;
 }
 
+/* apply the settings changed since the last hop, called between two hops
+ * with remaining frames of the current buffer left to analyse */
 static void
-gst_aubio_pitch_finalize (GObject * obj)
+gst_aubio_pitch_reconfigure (GstAubioPitch * filter, guint remaining)
 {
-  GstAubioPitch * aubio_pitch = GST_AUBIO_PITCH (obj);
+  gint changes;
+  gfloat tolerance, silence;
+  uint i;
 
-  if (aubio_pitch->t) {
-    del_aubio_pitch(aubio_pitch->t);
+  GST_OBJECT_LOCK (filter);
+  changes = filter->reconfigure;
+  filter->reconfigure = 0;
+  tolerance = filter->tolerance;
+  silence = filter->silence_threshold;
+  GST_OBJECT_UNLOCK (filter);
+
+  /* results from here on no longer match the cache entry */
+  if (filter->disk_cache.state != GST_AUBIO_DISK_CACHE_OFF) {
+    gst_aubio_pitch_end_chunk (filter);
+    gst_aubio_disk_cache_stop (&filter->disk_cache);
   }
-  if (aubio_pitch->ibuf) {
-    del_fvec(aubio_pitch->ibuf);
+
+  if (changes & RECONFIGURE_BUILD) {
+    /* the results of this buffer so far were sized for the previous
+     * hop size */
+    gboolean sync = filter->worker == NULL;
+
+    if (sync) {
+      gst_aubio_results_pad_finish (&filter->results,
+          &GST_BASE_TRANSFORM (filter)->segment);
+    }
+    gst_aubio_pitch_build (filter, filter->channels);
+    if (sync) {
+      gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+          remaining / filter->in_hop_size * filter->channels);
+    }
+  } else if (changes & RECONFIGURE_TUNE) {
+    if (filter->worker) {
+      gst_aubio_worker_drain (filter->worker);
+    }
+    for (i = 0; i < filter->channels; i++) {
+      aubio_pitch_set_tolerance (filter->t[i], tolerance);
+      aubio_pitch_set_silence (filter->t[i], silence);
+    }
   }
+}
+
+/* forget the stream analysed so far, after a flush, a new segment or a
+ * discontinuity. Hops queued before a flush are discarded, others are
+ * analysed first. */
+static void
+gst_aubio_pitch_reset (GstAubioPitch * filter, gboolean flush)
+{
+  filter->resync = TRUE;
+
+  if (filter->t == NULL)
+    return;
+
+  if (flush && filter->worker) {
+    gst_aubio_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+  if (flush) {
+    gst_aubio_disk_cache_stop (&filter->disk_cache);
+  } else if (filter->disk_cache.state != GST_AUBIO_DISK_CACHE_OFF) {
+    /* the cache entry covers the stream up to here */
+    gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+        filter->disk_cache.n_hops * filter->channels);
+    gst_aubio_pitch_end_chunk (filter);
+    gst_aubio_results_pad_finish (&filter->results,
+        &GST_BASE_TRANSFORM (filter)->segment);
+    gst_aubio_disk_cache_finish (&filter->disk_cache);
+  }
+  /* start over from silence, with the same detectors, unless they have
+   * not seen any audio yet, as on the segment that follows the caps */
+  if (!filter->fresh)
+    gst_aubio_pitch_build (filter, filter->channels);
+  g_array_set_size (filter->analysis, 0);
+}
+
+static gboolean
+gst_aubio_pitch_setup (GstAudioFilter * audiofilter,
+    const GstAudioInfo * info)
+{
+  GstAubioPitch *filter = GST_AUBIO_PITCH (audiofilter);
+
+  /* let the worker finish what was queued with the previous format */
+  if (filter->worker) {
+    gst_aubio_worker_drain (filter->worker);
+  }
+  gst_aubio_pitch_free_analysers (filter);
+
+  if (!gst_aubio_format_from_info (info, &filter->sample_format)) {
+    GST_ERROR_OBJECT (filter, "unsupported sample format");
+    return FALSE;
+  }
+
+  filter->samplerate = GST_AUDIO_INFO_RATE (info);
+  /* with attach-analysis, override passthrough_on_same_caps: the meta
+   * needs writable buffers */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter),
+      !filter->attach_analysis);
+  filter->resync = TRUE;
+
+  GST_OBJECT_LOCK (filter);
+  filter->reconfigure = 0;
+  GST_OBJECT_UNLOCK (filter);
+
+  /* one analyser per channel, or a single one on the downmixed signal */
+  if (!gst_aubio_pitch_build (filter,
+          filter->downmix ? 1 : GST_AUDIO_INFO_CHANNELS (info))) {
+    GST_ERROR_OBJECT (filter, "could not create pitch detector");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_aubio_pitch_finalize (GObject * obj)
+{
+  GstAubioPitch * aubio_pitch = GST_AUBIO_PITCH (obj);
+
+  gst_aubio_pitch_free_analysers (aubio_pitch);
+
+  g_array_free (aubio_pitch->analysis, TRUE);
+  g_free (aubio_pitch->method);
+  gst_aubio_stats_clear (&aubio_pitch->stats);
+  gst_aubio_disk_cache_free (&aubio_pitch->disk_cache);
+  g_free (aubio_pitch->cache_location);
+  gst_aubio_log_clear (&aubio_pitch->result_log);
+  g_free (aubio_pitch->log_location);
+  gst_aubio_ring_clear (&aubio_pitch->ring);
+
   if (aubio_pitch->obuf) {
     del_fvec(aubio_pitch->obuf);
   }
@@ -176,6 +911,130 @@ gst_aubio_pitch_set_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       filter->silent = g_value_get_boolean (value);
       break;
+    case PROP_DOWNMIX:
+      filter->downmix = g_value_get_boolean (value);
+      break;
+    case PROP_MESSAGE:
+      filter->message = g_value_get_boolean (value);
+      break;
+    case PROP_MESSAGE_HOPS:
+      filter->message_hops = g_value_get_uint (value);
+      break;
+    case PROP_MESSAGE_INTERVAL:
+      filter->message_interval = g_value_get_uint64 (value);
+      break;
+    case PROP_ATTACH_ANALYSIS:
+      filter->attach_analysis = g_value_get_boolean (value);
+      /* the meta needs writable buffers */
+      gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter),
+          !filter->attach_analysis);
+      break;
+    case PROP_ASYNC:
+      filter->async = g_value_get_boolean (value);
+      break;
+    case PROP_QUEUE_SIZE:
+      filter->queue_size = g_value_get_uint (value);
+      break;
+    case PROP_QUEUE_POLICY:
+      filter->queue_policy = g_value_get_enum (value);
+      break;
+    case PROP_SHARED_POOL:
+      filter->shared_pool = g_value_get_boolean (value);
+      break;
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->method);
+      filter->method = g_value_dup_string (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_BUF_SIZE:
+      GST_OBJECT_LOCK (filter);
+      filter->conf_buf_size = g_value_get_uint (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_HOP_SIZE:
+      GST_OBJECT_LOCK (filter);
+      filter->conf_hop_size = g_value_get_uint (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_TOLERANCE:
+      GST_OBJECT_LOCK (filter);
+      filter->tolerance = g_value_get_float (value);
+      filter->reconfigure |= RECONFIGURE_TUNE;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_SILENCE:
+      GST_OBJECT_LOCK (filter);
+      filter->silence_threshold = g_value_get_float (value);
+      filter->reconfigure |= RECONFIGURE_TUNE;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_GATE:
+      filter->gate = g_value_get_boolean (value);
+      break;
+    case PROP_GATE_THRESHOLD:
+      filter->gate_threshold = g_value_get_float (value);
+      break;
+    case PROP_GATE_HANGOVER:
+      filter->gate_hangover = g_value_get_uint (value);
+      break;
+    case PROP_DEGRADE:
+      filter->degrade = g_value_get_boolean (value);
+      /* the hop size only follows the quality level while degrading */
+      GST_OBJECT_LOCK (filter);
+      if (filter->qos.level > 0)
+        filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_DECIMATION:
+      GST_OBJECT_LOCK (filter);
+      filter->decimation = g_value_get_uint (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_LOW_LATENCY:
+      GST_OBJECT_LOCK (filter);
+      filter->low_latency = g_value_get_boolean (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MEDIAN_WINDOW:
+      GST_OBJECT_LOCK (filter);
+      filter->median_window = g_value_get_uint (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_EMIT:
+      filter->emit = g_value_get_enum (value);
+      break;
+    case PROP_EMIT_CENTS:
+      filter->emit_cents = g_value_get_float (value);
+      break;
+    case PROP_COLLECT_STATS:
+      gst_aubio_stats_set_enabled (&filter->stats,
+          g_value_get_boolean (value));
+      break;
+    case PROP_CACHE_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->cache_location);
+      filter->cache_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_LOG_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->log_location);
+      filter->log_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_RING_SIZE:
+      /* the ring is written without a lock while streaming */
+      if (gst_aubio_ring_configure (&filter->ring, GST_ELEMENT (filter),
+              g_value_get_uint (value)))
+        filter->ring_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -192,46 +1051,736 @@ gst_aubio_pitch_get_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       g_value_set_boolean (value, filter->silent);
       break;
+    case PROP_DOWNMIX:
+      g_value_set_boolean (value, filter->downmix);
+      break;
+    case PROP_MESSAGE:
+      g_value_set_boolean (value, filter->message);
+      break;
+    case PROP_MESSAGE_HOPS:
+      g_value_set_uint (value, filter->message_hops);
+      break;
+    case PROP_MESSAGE_INTERVAL:
+      g_value_set_uint64 (value, filter->message_interval);
+      break;
+    case PROP_ATTACH_ANALYSIS:
+      g_value_set_boolean (value, filter->attach_analysis);
+      break;
+    case PROP_ASYNC:
+      g_value_set_boolean (value, filter->async);
+      break;
+    case PROP_QUEUE_SIZE:
+      g_value_set_uint (value, filter->queue_size);
+      break;
+    case PROP_QUEUE_POLICY:
+      g_value_set_enum (value, filter->queue_policy);
+      break;
+    case PROP_SHARED_POOL:
+      g_value_set_boolean (value, filter->shared_pool);
+      break;
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->method);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_BUF_SIZE:
+      g_value_set_uint (value, filter->conf_buf_size);
+      break;
+    case PROP_HOP_SIZE:
+      g_value_set_uint (value, filter->conf_hop_size);
+      break;
+    case PROP_TOLERANCE:
+      g_value_set_float (value, filter->tolerance);
+      break;
+    case PROP_SILENCE:
+      g_value_set_float (value, filter->silence_threshold);
+      break;
+    case PROP_GATE:
+      g_value_set_boolean (value, filter->gate);
+      break;
+    case PROP_GATE_THRESHOLD:
+      g_value_set_float (value, filter->gate_threshold);
+      break;
+    case PROP_GATE_HANGOVER:
+      g_value_set_uint (value, filter->gate_hangover);
+      break;
+    case PROP_DEGRADE:
+      g_value_set_boolean (value, filter->degrade);
+      break;
+    case PROP_DECIMATION:
+      g_value_set_uint (value, filter->decimation);
+      break;
+    case PROP_LOW_LATENCY:
+      g_value_set_boolean (value, filter->low_latency);
+      break;
+    case PROP_MEDIAN_WINDOW:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->median_window);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_EMIT:
+      g_value_set_enum (value, filter->emit);
+      break;
+    case PROP_EMIT_CENTS:
+      g_value_set_float (value, filter->emit_cents);
+      break;
+    case PROP_LATENCY:
+      g_value_set_uint64 (value, filter->latency);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_aubio_stats_get (&filter->stats));
+      break;
+    case PROP_COLLECT_STATS:
+      g_value_set_boolean (value, g_atomic_int_get (&filter->stats.enabled));
+      break;
+    case PROP_CACHE_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->cache_location);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_LOG_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->log_location);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, filter->ring_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static GstBuffer *
+gst_aubio_pitch_pull_results (GstAubioPitch * filter)
+{
+  return gst_aubio_ring_pull (&filter->ring, GST_OBJECT (filter));
+}
+
+/* post the pending batch of results as a single element message */
+static void
+gst_aubio_pitch_flush_batch (GstAubioPitch * filter)
+{
+  GstStructure *s;
+  GValue timestamps = { 0, }, emitted = { 0, }, channels = { 0, };
+  GValue pitches = { 0, }, confidences = { 0, };
+  uint i;
+
+  if (filter->batch_len == 0)
+    return;
+
+  g_value_init (&timestamps, GST_TYPE_ARRAY);
+  g_value_init (&emitted, GST_TYPE_ARRAY);
+  g_value_init (&channels, GST_TYPE_ARRAY);
+  g_value_init (&pitches, GST_TYPE_ARRAY);
+  g_value_init (&confidences, GST_TYPE_ARRAY);
+
+  for (i = 0; i < filter->batch_len; i++) {
+    GstAubioResult *r = &filter->batch[i];
+
+    gst_aubio_value_array_append (&timestamps, G_TYPE_UINT64, &r->timestamp);
+    gst_aubio_value_array_append (&emitted, G_TYPE_UINT64, &r->emitted);
+    gst_aubio_value_array_append (&channels, G_TYPE_UINT, &r->channel);
+    gst_aubio_value_array_append (&pitches, G_TYPE_FLOAT, &r->value);
+    gst_aubio_value_array_append (&confidences, G_TYPE_FLOAT, &r->confidence);
+  }
+
+  s = gst_structure_new ("aubiopitch",
+      "timestamp", GST_TYPE_CLOCK_TIME, filter->batch[0].timestamp,
+      "count"    , G_TYPE_UINT        , filter->batch_len,
+      NULL);
+  gst_structure_take_value (s, "timestamps", &timestamps);
+  gst_structure_take_value (s, "emitted", &emitted);
+  gst_structure_take_value (s, "channels", &channels);
+  gst_structure_take_value (s, "pitches", &pitches);
+  gst_structure_take_value (s, "confidences", &confidences);
+
+  gst_element_post_message (GST_ELEMENT (filter),
+      gst_message_new_element (GST_OBJECT (filter), s));
+
+  filter->batch_len = 0;
+  filter->batch_hops = 0;
+}
+
+/* called once per hop, after all channels have been analysed */
+static void
+gst_aubio_pitch_end_hop (GstAubioPitch * filter)
+{
+  GstClockTime first, last;
+
+  if (filter->batch_len == 0)
+    return;
+
+  filter->batch_hops++;
+  first = filter->batch[0].timestamp;
+  last = filter->batch[filter->batch_len - 1].timestamp;
+
+  if (filter->batch_len + filter->channels > filter->batch_size
+      || (filter->message_hops > 0
+          && filter->batch_hops >= filter->message_hops)
+      || (GST_CLOCK_TIME_IS_VALID (first) && GST_CLOCK_TIME_IS_VALID (last)
+          && last - first >= filter->message_interval)) {
+    gst_aubio_pitch_flush_batch (filter);
+  }
+}
+
+/* whether pitch differs enough from the last one reported on channel to
+ * be reported with emit=change */
+static gboolean
+gst_aubio_pitch_changed (GstAubioPitch * filter, uint channel, gfloat pitch)
+{
+  gfloat last = filter->last_pitch[channel];
+
+  if (last < 0.)
+    return TRUE;
+  /* voicing changes */
+  if ((last > 0.) != (pitch > 0.))
+    return TRUE;
+  if (pitch == 0.)
+    return FALSE;
+
+  return fabs (1200. * log2 (pitch / last)) >= filter->emit_cents;
+}
+
+/* report the pitch found in a hop, now is the time of its last sample.
+ * Returns the number of results reported, 0 when emit=change skipped it */
+static guint
+gst_aubio_pitch_report (GstAubioPitch * filter, uint channel, gfloat pitch,
+    gfloat confidence, GstClockTime now)
+{
+  GstAubioResult r;
+  GstClockTime latency, when;
+
+  latency = filter->latency;
+  if (filter->median) {
+    GstAubioMedian *median = filter->median[channel];
+
+    /* unvoiced hops count as 0 Hz, so that the voicing only changes once
+     * most of the window agrees */
+    pitch = gst_aubio_median_push (median, pitch);
+    /* until the window fills, the median is that of the middle of the
+     * hops seen so far */
+    latency -= GST_FRAMES_TO_CLOCK_TIME ((median->size - median->count)
+        * filter->in_hop_size / 2, filter->samplerate);
+  }
+  /* one value per channel and hop in the analysis meta, only attached
+   * when analysing on the streaming thread */
+  if (filter->attach_analysis && filter->worker == NULL) {
+    gfloat value = pitch;
+    g_array_append_val (filter->analysis, value);
+  }
+
+  if (filter->emit == GST_AUBIO_PITCH_EMIT_CHANGE
+      && !gst_aubio_pitch_changed (filter, channel, pitch))
+    return 0;
+  filter->last_pitch[channel] = pitch;
+
+  when = now > latency ? now - latency : 0;
+
+  r.timestamp = when;
+  r.value = pitch;
+  r.confidence = confidence;
+  r.channel = channel;
+  r.kind = GST_AUBIO_RESULT_PITCH;
+  r.emitted = now;
+
+  if (filter->message && filter->batch_len < filter->batch_size) {
+    filter->batch[filter->batch_len++] = r;
+  }
+  gst_aubio_log_append (&filter->result_log, &r);
+  gst_aubio_ring_push (&filter->ring, &r);
+  gst_aubio_results_pad_append (&filter->results, &r);
+
+  if (filter->silent == FALSE) {
+    if (filter->channels > 1) {
+      g_print ("%" GST_TIME_FORMAT "\tchannel: %u\tpitch: %.3f\n",
+              GST_TIME_ARGS(when), channel, pitch);
+    } else {
+      g_print ("%" GST_TIME_FORMAT "\tpitch: %.3f\n",
+              GST_TIME_ARGS(when), pitch);
+    }
+  }
+
+  GST_LOG_OBJECT (filter, "pitch %" GST_TIME_FORMAT ", channel %u, freq %3.2f"
+          ", emitted %" GST_TIME_FORMAT, GST_TIME_ARGS(when), channel, pitch,
+          GST_TIME_ARGS(now));
+
+  return 1;
+}
+
+/* now is the time of the last sample of the hop */
+static void
+gst_aubio_pitch_process_hop (GstAubioPitch * filter, uint channel,
+    const fvec_t * hop, GstClockTime now)
+{
+  smpl_t pitch;
+  gfloat confidence;
+  GstClockTime time;
+  guint results;
+
+  if (filter->gate && !gst_aubio_gate_hop (hop, filter->gate_threshold,
+          filter->gate_hangover, &filter->gate_hold[channel])) {
+    /* too quiet to hold a pitch, report it unvoiced without running the
+     * detector */
+    pitch = 0.;
+    confidence = 0.;
+    time = GST_CLOCK_TIME_NONE;
+  } else {
+    /* timed only when something listens to the hops */
+    gboolean timed = gst_aubio_stats_active (&filter->stats);
+    GstClockTime start = timed ? gst_util_get_timestamp () : 0;
+
+    aubio_pitch_do(filter->t[channel], hop, filter->obuf);
+    time = timed ? gst_util_get_timestamp () - start : 0;
+    pitch = filter->obuf->data[0];
+    confidence = aubio_pitch_get_confidence (filter->t[channel]);
+
+    /* the window still holds the stream the detector analysed before */
+    if (filter->stale[channel] > 0) {
+      filter->stale[channel]--;
+      pitch = 0.;
+      confidence = 0.;
+    }
+  }
+
+  gst_aubio_disk_cache_add_result (&filter->disk_cache, channel, pitch,
+      confidence);
+  results = gst_aubio_pitch_report (filter, channel, pitch, confidence, now);
+  if (gst_aubio_stats_active (&filter->stats))
+    gst_aubio_stats_hop (&filter->stats, GST_OBJECT (filter), channel, time,
+        results);
+}
+
+/* attach the pitches found in buf to it */
+static void
+gst_aubio_pitch_attach_analysis (GstAubioPitch * filter, GstBuffer * buf)
+{
+  if (filter->analysis->len == 0)
+    return;
+
+  /* not in place yet when attach-analysis was just set */
+  if (gst_buffer_is_writable (buf)) {
+    gst_buffer_add_aubio_pitch_analysis_meta (buf, filter->channels,
+        (const gfloat *) filter->analysis->data, filter->analysis->len);
+  } else {
+    GST_DEBUG_OBJECT (filter, "buffer not writable, analysis dropped");
+  }
+
+  g_array_set_size (filter->analysis, 0);
+}
+
+static gboolean
+gst_aubio_pitch_stop (GstBaseTransform * trans)
+{
+  GstAubioPitch *filter = GST_AUBIO_PITCH (trans);
+
+  /* the worker is started again by the first buffer */
+  if (filter->worker) {
+    gst_aubio_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+  GST_OBJECT_LOCK (filter);
+  if (filter->qos.level > 0)
+    filter->reconfigure |= RECONFIGURE_BUILD;
+  GST_OBJECT_UNLOCK (filter);
+  gst_aubio_qos_reset (&filter->qos, GST_ELEMENT (filter));
+  gst_aubio_disk_cache_stop (&filter->disk_cache);
+  gst_aubio_log_close (&filter->result_log);
+
+  return TRUE;
+}
+
+static gboolean
+gst_aubio_pitch_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstAubioPitch *filter = GST_AUBIO_PITCH (trans);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      gst_aubio_pitch_reset (filter, TRUE);
+      break;
+    case GST_EVENT_SEGMENT:
+      gst_aubio_pitch_reset (filter, FALSE);
+      break;
+    case GST_EVENT_EOS:
+      gst_aubio_pitch_drain_hop (filter);
+      if (filter->worker) {
+        gst_aubio_worker_drain (filter->worker);
+      }
+      gst_aubio_pitch_flush_batch (filter);
+      break;
+    default:
+      break;
+  }
+
+  gst_aubio_results_pad_event (&filter->results, GST_ELEMENT (filter), event);
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+static gboolean
+gst_aubio_pitch_src_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstAubioPitch *filter = GST_AUBIO_PITCH (trans);
+
+  gst_aubio_qos_event (&filter->qos, GST_ELEMENT (filter), event);
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->src_event (trans, event);
+}
+
+/* analyse one hop of every channel, then report the results */
+static void
+gst_aubio_pitch_analyse_hop (GstAubioPitch * filter, fvec_t ** hops,
+    GstClockTime now)
+{
+  uint c;
+
+  for (c = 0; c < filter->channels; c++) {
+    gst_aubio_pitch_process_hop (filter, c, hops[c], now);
+  }
+  gst_aubio_pitch_end_hop (filter);
+}
+
+/* GstAubioWorkerFunc, analyses a queued hop on the worker thread */
+static void
+gst_aubio_pitch_worker_func (GstAubioHop * hop, gpointer user_data)
+{
+  GstAubioPitch *filter = GST_AUBIO_PITCH (user_data);
+
+  gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+      filter->channels);
+  gst_aubio_pitch_analyse_hop (filter, hop->channels, hop->timestamp);
+  gst_aubio_results_pad_finish (&filter->results,
+      &GST_BASE_TRANSFORM (filter)->segment);
+}
+
+/* report the hops of the current chunk of the disk cache, from the entry
+ * when they match it, or by analysing them */
+static void
+gst_aubio_pitch_end_chunk (GstAubioPitch * filter)
+{
+  GstAubioDiskCache *cache = &filter->disk_cache;
+  gfloat pitch, confidence;
+  fvec_t hop;
+  uint h, c;
+
+  switch (gst_aubio_disk_cache_end_chunk (cache)) {
+    case GST_AUBIO_DISK_CACHE_HIT:
+      for (h = 0; h < cache->n_hops; h++) {
+        for (c = 0; c < filter->channels; c++) {
+          gst_aubio_disk_cache_result (cache, h, c, &pitch, &confidence);
+          gst_aubio_pitch_report (filter, c, pitch, confidence,
+              cache->ends[h]);
+        }
+        gst_aubio_pitch_end_hop (filter);
+      }
+      break;
+    case GST_AUBIO_DISK_CACHE_MISS:
+      GST_DEBUG_OBJECT (filter, "stream differs from the cache entry");
+      for (h = 0; h < cache->n_hops; h++) {
+        for (c = 0; c < filter->channels; c++) {
+          gst_aubio_disk_cache_hop (cache, h, c, &hop);
+          gst_aubio_pitch_process_hop (filter, c, &hop, cache->ends[h]);
+        }
+        gst_aubio_pitch_end_hop (filter);
+      }
+      break;
+    default:
+      break;
+  }
+  gst_aubio_disk_cache_next_chunk (cache);
+}
+
+/* analyse or replay a hop through the disk cache */
+static void
+gst_aubio_pitch_cache_hop (GstAubioPitch * filter, fvec_t ** hops,
+    GstClockTime now)
+{
+  GstAubioDiskCache *cache = &filter->disk_cache;
+
+  gst_aubio_disk_cache_add_hop (cache, hops, now);
+  if (!gst_aubio_disk_cache_replaying (cache)) {
+    gst_aubio_pitch_analyse_hop (filter, hops, now);
+  }
+  if (cache->n_hops == GST_AUBIO_DISK_CACHE_CHUNK) {
+    gst_aubio_pitch_end_chunk (filter);
+  }
+}
+
+/* start a new entry of the disk cache, if any, at the start of a stream */
+static void
+gst_aubio_pitch_start_cache (GstAubioPitch * filter)
+{
+  gchar *location, *params;
+
+  GST_OBJECT_LOCK (filter);
+  location = g_strdup (filter->cache_location);
+  params = g_strdup_printf ("aubiopitch %s %u %u %u %u %u %g %g %d %g %u",
+      filter->t_method, filter->buf_size, filter->hop_size, filter->t_rate,
+      filter->factor, filter->channels, filter->tolerance,
+      filter->silence_threshold, filter->gate, filter->gate_threshold,
+      filter->gate_hangover);
+  GST_OBJECT_UNLOCK (filter);
+
+  /* queued hops are analysed out of order with the cache */
+  if (filter->async) {
+    g_free (location);
+    location = NULL;
+  }
+  gst_aubio_disk_cache_start (&filter->disk_cache, location, params,
+      filter->channels, filter->hop_size);
+
+  g_free (location);
+  g_free (params);
+}
+
+/* open the result log, if any, and number the results that follow as a
+ * new stream */
+static gboolean
+gst_aubio_pitch_start_log (GstAubioPitch * filter)
+{
+  gchar *location;
+  gboolean ret = TRUE;
+
+  GST_OBJECT_LOCK (filter);
+  location = g_strdup (filter->log_location);
+  GST_OBJECT_UNLOCK (filter);
+
+  if (location && !gst_aubio_log_is_open (&filter->result_log)) {
+    ret = gst_aubio_log_open (&filter->result_log, GST_OBJECT (filter),
+        location);
+  }
+  if (ret) {
+    gst_aubio_log_new_stream (&filter->result_log);
+  }
+  g_free (location);
+
+  return ret;
+}
+
+/* analyse a complete hop now, or queue it for the worker thread */
+static void
+gst_aubio_pitch_dispatch_hop (GstAubioPitch * filter, fvec_t ** hops,
+    GstClockTime now)
+{
+  if (filter->disk_cache.state != GST_AUBIO_DISK_CACHE_OFF
+      && filter->worker == NULL) {
+    gst_aubio_pitch_cache_hop (filter, hops, now);
+    return;
+  }
+
+  if (filter->worker == NULL) {
+    gst_aubio_pitch_analyse_hop (filter, hops, now);
+  } else if (!gst_aubio_worker_push (filter->worker, hops, now, 0,
+          filter->queue_policy)) {
+    gst_aubio_stats_dropped (&filter->stats, GST_OBJECT (filter), 1);
+    GST_DEBUG_OBJECT (filter, "queue full, dropped hop at %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (now));
+  }
+}
+
+/* downsample a complete hop of every channel, the delay of the filter is
+ * part of the latency */
+static fvec_t **
+gst_aubio_pitch_decimate (GstAubioPitch * filter, fvec_t ** hops)
+{
+  uint c;
+
+  for (c = 0; c < filter->channels; c++) {
+    gst_aubio_decimator_do (filter->dec[c], hops[c], filter->dbuf[c]);
+  }
+
+  return filter->dbuf;
+}
+
+/* analyse the last, incomplete hop, padded with silence */
+static void
+gst_aubio_pitch_drain_hop (GstAubioPitch * filter)
+{
+  GstClockTime now;
+  fvec_t **hops;
+  uint c;
+
+  if (filter->t == NULL)
+    return;
+
+  if (filter->pos == 0 && filter->disk_cache.n_hops == 0) {
+    gst_aubio_disk_cache_finish (&filter->disk_cache);
+    return;
+  }
+
+  if (filter->worker == NULL) {
+    gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+        (filter->disk_cache.n_hops + 1) * filter->channels);
+  }
+
+  if (filter->pos > 0) {
+    for (c = 0; c < filter->channels; c++) {
+      memset (filter->ibuf[c]->data + filter->pos, 0,
+          (filter->in_hop_size - filter->pos) * sizeof (smpl_t));
+    }
+    now = filter->start_time + GST_FRAMES_TO_CLOCK_TIME (filter->frames
+        + filter->in_hop_size - filter->pos - 1, filter->samplerate);
+    filter->pos = 0;
+
+    hops = filter->ibuf;
+    if (filter->factor > 1) {
+      hops = gst_aubio_pitch_decimate (filter, hops);
+    }
+    gst_aubio_pitch_dispatch_hop (filter, hops, now);
+  }
+
+  /* the last, incomplete chunk of the cache */
+  gst_aubio_pitch_end_chunk (filter);
+  gst_aubio_disk_cache_finish (&filter->disk_cache);
+
+  if (filter->worker == NULL) {
+    gst_aubio_results_pad_finish (&filter->results,
+        &GST_BASE_TRANSFORM (filter)->segment);
+    /* no buffer left to attach them to */
+    g_array_set_size (filter->analysis, 0);
+  }
+}
+
 static GstFlowReturn
 gst_aubio_pitch_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
 {
-  uint j;
+  guint j, len;
   GstAubioPitch *filter = GST_AUBIO_PITCH (trans);
   GstAudioFilter *audiofilter = GST_AUDIO_FILTER(trans);
+  guint channels = GST_AUDIO_FILTER_CHANNELS (audiofilter);
+  guint bpf = GST_AUDIO_FILTER_BPF (audiofilter);
+  GstMapInfo map;
+  guint8 *data;
+  GstClockTime now;
+  fvec_t view, *viewp = &view, **hops;
 
-  gint nsamples = GST_BUFFER_SIZE (buf) / (4 * audiofilter->format.channels);
+  guint nsamples;
 
-  /* block loop */
-  for (j = 0; j < nsamples; j++) {
-    /* copy input to ibuf */
-    fvec_write_sample(filter->ibuf, ((smpl_t *) GST_BUFFER_DATA(buf))[j],
-        filter->pos);
+  if (G_UNLIKELY (filter->t == NULL))
+    return GST_FLOW_NOT_NEGOTIATED;
 
-    if (filter->pos == filter->hop_size - 1) {
-      aubio_pitch_do(filter->t, filter->ibuf, filter->obuf);
-      smpl_t pitch = filter->obuf->data[0];
-      GstClockTime now = GST_BUFFER_TIMESTAMP (buf);
-      // correction of inside buffer time
-      now += GST_FRAMES_TO_CLOCK_TIME(j, audiofilter->format.rate);
+  gst_aubio_stats_buffer (&filter->stats, gst_buffer_get_size (buf));
 
-      if (filter->silent == FALSE) {
-        g_print ("%" GST_TIME_FORMAT "\tpitch: %.3f\n",
-                GST_TIME_ARGS(now), pitch);
-      }
+  if (GST_BUFFER_IS_DISCONT (buf) && !filter->resync) {
+    GST_DEBUG_OBJECT (filter, "discontinuity, dropping %u frames", filter->pos);
+    gst_aubio_pitch_reset (filter, FALSE);
+  }
+  if (filter->resync) {
+    if (!gst_aubio_pitch_start_log (filter))
+      return GST_FLOW_ERROR;
+    filter->start_time = GST_BUFFER_PTS_IS_VALID (buf) ?
+        GST_BUFFER_PTS (buf) : 0;
+    filter->frames = 0;
+    filter->resync = FALSE;
+    gst_aubio_pitch_start_cache (filter);
+  }
 
-      GST_LOG_OBJECT (filter, "pitch %" GST_TIME_FORMAT ", freq %3.2f",
-              GST_TIME_ARGS(now), pitch);
+  /* the samples are only read, mapping never copies them */
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+  data = map.data;
+  nsamples = map.size / bpf;
 
-      filter->pos = -1; /* so it will be zero next j loop */
+  if (filter->async && filter->worker == NULL) {
+    filter->worker = gst_aubio_worker_new ("aubiopitch", filter->queue_size,
+        filter->channels, filter->hop_size, filter->shared_pool,
+        gst_aubio_pitch_worker_func, filter);
+  }
+
+  if (filter->worker == NULL) {
+    gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+        (filter->pos + nsamples) / filter->in_hop_size * filter->channels);
+  }
+
+  if (filter->degrade) {
+    gst_aubio_qos_begin (&filter->qos);
+  }
+
+  /* hop loop, runs once per hop */
+  for (j = 0; j < nsamples; j += len) {
+    if (G_UNLIKELY (g_atomic_int_get (&filter->reconfigure))
+        && filter->pos == 0) {
+      gst_aubio_pitch_reconfigure (filter, nsamples - j);
     }
-    filter->pos++;
+
+    if (channels == 1 && filter->sample_format == GST_AUBIO_FORMAT_NATIVE
+        && filter->factor == 1
+        && filter->pos == 0 && nsamples - j >= filter->hop_size) {
+      /* a full hop is available in place, analyse it without copying */
+      len = filter->hop_size;
+      view.length = len;
+      view.data = (smpl_t *) (data + j * bpf);
+      hops = &viewp;
+    } else {
+      /* convert and deinterleave as much input as fits to the channel
+       * ibufs */
+      len = MIN (filter->in_hop_size - filter->pos, nsamples - j);
+      gst_aubio_deinterleave (filter->ibuf, filter->pos, data + j * bpf,
+          filter->sample_format, channels, len, filter->downmix);
+      filter->pos += len;
+
+      if (filter->pos < filter->in_hop_size)
+        continue;
+      filter->pos = 0;
+      hops = filter->ibuf;
+    }
+
+    now = filter->start_time;
+    // correction of inside buffer time
+    now += GST_FRAMES_TO_CLOCK_TIME(filter->frames + j + len - 1,
+        GST_AUDIO_FILTER_RATE (audiofilter));
+
+    if (filter->factor > 1) {
+      hops = gst_aubio_pitch_decimate (filter, hops);
+    }
+
+    gst_aubio_pitch_dispatch_hop (filter, hops, now);
+
+    if (filter->low_latency && filter->worker == NULL) {
+      /* push the results of this hop right away */
+      gst_aubio_results_pad_finish (&filter->results, &trans->segment);
+      gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+          (nsamples - j - len) / filter->in_hop_size * filter->channels);
+    }
+  }
+
+  filter->frames += nsamples;
+  filter->fresh = FALSE;
+  gst_buffer_unmap (buf, &map);
+
+  if (filter->worker == NULL) {
+    gst_aubio_results_pad_finish (&filter->results, &trans->segment);
+    gst_aubio_pitch_attach_analysis (filter, buf);
+  }
+
+  if (filter->degrade && gst_aubio_qos_end (&filter->qos,
+          GST_ELEMENT (filter), GST_FRAMES_TO_CLOCK_TIME (nsamples,
+              GST_AUDIO_FILTER_RATE (audiofilter)))) {
+    /* the new level takes new detectors, from the next hop */
+    GST_OBJECT_LOCK (filter);
+    filter->reconfigure |= RECONFIGURE_BUILD;
+    GST_OBJECT_UNLOCK (filter);
   }
 
   return GST_FLOW_OK;
 }
+
+static GstPad *
+gst_aubio_pitch_request_new_pad (GstElement * element, GstPadTemplate * templ,
+    const gchar * name, const GstCaps * caps)
+{
+  GstAubioPitch *filter = GST_AUBIO_PITCH (element);
+
+  return gst_aubio_results_pad_request (&filter->results, element, templ,
+      "application/x-aubio-pitch");
+}
+
+static void
+gst_aubio_pitch_release_pad (GstElement * element, GstPad * pad)
+{
+  GstAubioPitch *filter = GST_AUBIO_PITCH (element);
+
+  gst_aubio_results_pad_release (&filter->results, element, pad);
+}
@@ -28,6 +28,16 @@
 
 #include <aubio/aubio.h>
 
+#include "gstaubioutils.h"
+#include "gstaubioqos.h"
+#include "gstaubioresults.h"
+#include "gstaubiostats.h"
+#include "gstaubiodiskcache.h"
+#include "gstaubiolog.h"
+#include "gstaubiomedian.h"
+#include "gstaubioring.h"
+#include "gstaubioworker.h"
+
 G_BEGIN_DECLS
 
 /* #defines don't like whitespacey bits */
@@ -44,6 +54,16 @@ G_BEGIN_DECLS
 #define GST_AUBIO_PITCH_GET_CLASS(obj) \
   (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_AUBIO_PITCH, GstAubioPitchClass))
 
+/* which pitches are reported */
+typedef enum
+{
+  GST_AUBIO_PITCH_EMIT_HOP,     /* one per hop */
+  GST_AUBIO_PITCH_EMIT_CHANGE   /* when the pitch or the voicing changes */
+} GstAubioPitchEmit;
+
+#define GST_TYPE_AUBIO_PITCH_EMIT (gst_aubio_pitch_emit_get_type ())
+GType gst_aubio_pitch_emit_get_type (void);
+
 typedef struct _GstAubioPitch      GstAubioPitch;
 typedef struct _GstAubioPitchClass GstAubioPitchClass;
 
@@ -54,22 +74,104 @@ struct _GstAubioPitch
   GstPad *sinkpad, *srcpad;
 
   gboolean silent;
-
-  aubio_pitch_t * t;
-  fvec_t * ibuf;
+  gboolean downmix;
+  gboolean message;
+  guint message_hops;
+  guint64 message_interval;
+  gboolean attach_analysis;
+  gboolean async;
+  guint queue_size;
+  GstAubioQueuePolicy queue_policy;
+  gboolean shared_pool;
+
+  /* analysis settings, protected by the object lock and applied at the
+   * next hop boundary */
+  gchar * method;
+  guint conf_buf_size;  /* 0 to scale the default to the rate */
+  guint conf_hop_size;  /* 0 to scale the default to the rate */
+  gfloat tolerance;
+  gfloat silence_threshold;
+  guint decimation;     /* downsampling factor ahead of the detector */
+  gboolean low_latency; /* smallest window and per hop results */
+  guint median_window;  /* hops the reported pitch is the median of */
+  volatile gint reconfigure;    /* pending changes to the settings */
+
+  /* energy gate, hops below gate_threshold (dB) are not analysed */
+  gboolean gate;
+  gfloat gate_threshold;
+  guint gate_hangover;  /* in hops */
+  guint * gate_hold;    /* per analysed channel */
+
+  /* hops left before the window of a reused detector only holds audio of
+   * this stream, reported unvoiced, per analysed channel */
+  guint * stale;
+
+  /* with emit=change, only report the pitch once it moved by emit_cents
+   * from the last one reported, or when the voicing changes */
+  GstAubioPitchEmit emit;
+  gfloat emit_cents;
+  GstAubioMedian ** median;     /* per analysed channel, NULL for a window
+                                 * of 1 */
+  gfloat * last_pitch;  /* last reported per analysed channel, -1 for none */
+
+  gboolean degrade;     /* decimate the analysis when falling behind */
+  GstAubioQos qos;
+  GstAubioStats stats;
+
+  gchar * cache_location;       /* protected by the object lock */
+  GstAubioDiskCache disk_cache;
+
+  gchar * log_location;         /* protected by the object lock */
+  GstAubioLog result_log;
+
+  guint ring_size;
+  GstAubioRing ring;    /* results for pull-results */
+
+  aubio_pitch_t ** t;   /* one detector per analysed channel */
+  gchar * t_method;     /* method and rate the detectors were created */
+  uint t_rate;          /* with, to return them to the cache */
+  fvec_t ** ibuf;       /* one hop vector per analysed channel */
   fvec_t * obuf;
 
-  uint buf_size;
-  uint hop_size;
-  uint channels;
+  /* decimating front end, when factor > 1 */
+  GstAubioDecimator ** dec;     /* one per analysed channel */
+  fvec_t ** dbuf;       /* decimated hop of each analysed channel */
+  uint factor;
+
+  uint buf_size;        /* at the analysis rate */
+  uint hop_size;        /* at the analysis rate */
+  uint in_hop_size;     /* hop_size * factor, at the stream rate */
+  GstClockTime latency; /* from the analysed audio to its result */
+  GstAubioFormat sample_format;
+  uint channels;        /* number of analysed channels */
   uint samplerate;
-  signed int pos;
+  uint pos;
+
+  /* running sample counter the hops are timed with */
+  gboolean resync;      /* take the time of the next buffer */
+  gboolean fresh;       /* no audio analysed since the detectors were built */
+  GstClockTime start_time;      /* time of the first frame counted */
+  guint64 frames;       /* frames received since then */
+
+  GstAubioResultsPad results;
+  GArray * analysis;    /* pitches found in the current buffer */
+
+  GstAubioWorker * worker;  /* analysis thread in async mode */
+
+  /* pending results, posted as one message per batch */
+  GstAubioResult * batch;
+  uint batch_size;
+  uint batch_len;
+  uint batch_hops;
 
 };
 
 struct _GstAubioPitchClass 
 {
   GstAudioFilterClass parent_class;
+
+  /* actions */
+  GstBuffer * (*pull_results) (GstAubioPitch * filter);
 };
 
 GType gst_aubio_pitch_get_type (void);
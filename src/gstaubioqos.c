@@ -0,0 +1,134 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "gstaubioqos.h"
+
+/* hops at most 8 times longer */
+#define MAX_LEVEL 3
+/* buffers to wait after a change before changing the level again */
+#define HOLD_BUFFERS 16
+/* degrade above this load, recover once the next level would stay below
+ * the lower bound */
+#define HIGH_LOAD 0.9
+#define LOW_LOAD 0.7
+/* weight of the last buffer in the smoothed load */
+#define LOAD_SMOOTHING 0.25
+
+void
+gst_aubio_qos_reset (GstAubioQos * qos, GstElement * element)
+{
+  GST_OBJECT_LOCK (element);
+  qos->proportion = 1.;
+  GST_OBJECT_UNLOCK (element);
+
+  qos->level = 0;
+  qos->hold = 0;
+  qos->load = 0.;
+  qos->start = 0;
+}
+
+void
+gst_aubio_qos_event (GstAubioQos * qos, GstElement * element,
+    GstEvent * event)
+{
+  GstQOSType type;
+  gdouble proportion;
+  GstClockTimeDiff diff;
+  GstClockTime timestamp;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_QOS)
+    return;
+
+  gst_event_parse_qos (event, &type, &proportion, &diff, &timestamp);
+
+  GST_OBJECT_LOCK (element);
+  qos->proportion = proportion;
+  GST_OBJECT_UNLOCK (element);
+}
+
+void
+gst_aubio_qos_begin (GstAubioQos * qos)
+{
+  qos->start = g_get_monotonic_time ();
+}
+
+static void
+gst_aubio_qos_post (GstAubioQos * qos, GstElement * element,
+    gdouble proportion)
+{
+  GstStructure *s;
+
+  GST_INFO_OBJECT (element, "quality level %u, hops %u times longer, "
+      "load %.2f, proportion %.2f", qos->level, 1 << qos->level, qos->load,
+      proportion);
+
+  s = gst_structure_new (GST_AUBIO_QUALITY_NAME,
+      "level"     , G_TYPE_UINT  , qos->level,
+      "decimation", G_TYPE_UINT  , 1 << qos->level,
+      "load"      , G_TYPE_DOUBLE, qos->load,
+      "proportion", G_TYPE_DOUBLE, proportion,
+      NULL);
+  gst_element_post_message (element,
+      gst_message_new_element (GST_OBJECT (element), s));
+}
+
+/* account for the analysis of a buffer of duration, started by the last
+ * gst_aubio_qos_begin, and adjust the level */
+gboolean
+gst_aubio_qos_end (GstAubioQos * qos, GstElement * element,
+    GstClockTime duration)
+{
+  gdouble proportion, load;
+
+  if (GST_CLOCK_TIME_IS_VALID (duration) && duration > 0) {
+    load = (gdouble) (g_get_monotonic_time () - qos->start) * GST_USECOND
+        / duration;
+    qos->load += LOAD_SMOOTHING * (load - qos->load);
+  }
+
+  if (qos->hold > 0) {
+    qos->hold--;
+    return FALSE;
+  }
+
+  GST_OBJECT_LOCK (element);
+  proportion = qos->proportion;
+  GST_OBJECT_UNLOCK (element);
+
+  if ((qos->load > HIGH_LOAD || proportion > 1.) && qos->level < MAX_LEVEL) {
+    qos->level++;
+  } else if (qos->load * 2. < LOW_LOAD && proportion <= 1.
+      && qos->level > 0) {
+    /* analysing twice the hops should still fit */
+    qos->level--;
+  } else {
+    return FALSE;
+  }
+
+  qos->hold = HOLD_BUFFERS;
+  gst_aubio_qos_post (qos, element, proportion);
+
+  return TRUE;
+}
@@ -0,0 +1,64 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __GST_AUBIO_QOS_H__
+#define __GST_AUBIO_QOS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* name of the element message posted when the quality level changes */
+#define GST_AUBIO_QUALITY_NAME "aubio-quality"
+
+/* Decimation of the analysis when the pipeline falls behind. At level n,
+ * the detectors run on hops 2^n times longer, with the same window, so
+ * they still see contiguous audio. The level goes up when downstream QoS
+ * events report late buffers or when analysing a buffer takes longer
+ * than playing it, and back down once there is headroom again. */
+typedef struct
+{
+  guint level;
+  guint hold;           /* buffers left before the level may change */
+  gdouble proportion;   /* from the last QoS event, object lock */
+  gdouble load;         /* smoothed analysis time / stream time */
+  gint64 start;         /* monotonic time the current buffer began */
+} GstAubioQos;
+
+void gst_aubio_qos_reset (GstAubioQos * qos, GstElement * element);
+void gst_aubio_qos_event (GstAubioQos * qos, GstElement * element,
+    GstEvent * event);
+
+void gst_aubio_qos_begin (GstAubioQos * qos);
+/* TRUE when the level changed, the detectors are then to be rebuilt */
+gboolean gst_aubio_qos_end (GstAubioQos * qos, GstElement * element,
+    GstClockTime duration);
+
+/* hop_size at the current level, at most buf_size */
+static inline guint
+gst_aubio_qos_hop_size (GstAubioQos * qos, guint hop_size, guint buf_size)
+{
+  return MIN (hop_size << qos->level, MAX (buf_size, hop_size));
+}
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_QOS_H__ */
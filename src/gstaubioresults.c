@@ -0,0 +1,270 @@
+/*
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "gstaubioresults.h"
+
+/* append the value of the given type pointed to by v to a GST_TYPE_ARRAY */
+void
+gst_aubio_value_array_append (GValue * array, GType type, gconstpointer v)
+{
+  GValue item = { 0, };
+
+  g_value_init (&item, type);
+  switch (type) {
+    case G_TYPE_UINT64:
+      g_value_set_uint64 (&item, *(const guint64 *) v);
+      break;
+    case G_TYPE_INT64:
+      g_value_set_int64 (&item, *(const gint64 *) v);
+      break;
+    case G_TYPE_UINT:
+      g_value_set_uint (&item, *(const guint *) v);
+      break;
+    case G_TYPE_DOUBLE:
+      g_value_set_double (&item, *(const gdouble *) v);
+      break;
+    default:
+      g_value_set_float (&item, *(const gfloat *) v);
+      break;
+  }
+  gst_value_array_append_value (array, &item);
+  g_value_unset (&item);
+}
+
+/* answer latency queries with the upstream latency plus the delay of the
+ * analysis, forward the others */
+static gboolean
+gst_aubio_results_pad_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstAubioResultsPad *rp = gst_pad_get_element_private (pad);
+  GstElement *element = GST_ELEMENT (parent);
+  GstPad *sinkpad;
+  GstClockTime min, max, latency;
+  gboolean live, res;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_LATENCY)
+    return gst_pad_query_default (pad, parent, query);
+
+  sinkpad = gst_element_get_static_pad (element, "sink");
+  res = gst_pad_peer_query (sinkpad, query);
+  if (res) {
+    gst_query_parse_latency (query, &live, &min, &max);
+
+    GST_OBJECT_LOCK (element);
+    latency = rp->latency;
+    GST_OBJECT_UNLOCK (element);
+
+    GST_DEBUG_OBJECT (pad, "upstream latency %" GST_TIME_FORMAT
+        ", analysis %" GST_TIME_FORMAT, GST_TIME_ARGS (min),
+        GST_TIME_ARGS (latency));
+
+    min += latency;
+    if (GST_CLOCK_TIME_IS_VALID (max))
+      max += latency;
+    gst_query_set_latency (query, live, min, max);
+  }
+
+  gst_object_unref (sinkpad);
+
+  return res;
+}
+
+GstPad *
+gst_aubio_results_pad_request (GstAubioResultsPad * rp, GstElement * element,
+    GstPadTemplate * templ, const gchar * media_type)
+{
+  GstPad *pad;
+  GstCaps *caps;
+  gchar *stream_id;
+
+  GST_OBJECT_LOCK (element);
+  if (rp->pad != NULL) {
+    GST_OBJECT_UNLOCK (element);
+    GST_WARNING_OBJECT (element, "results pad already requested");
+    return NULL;
+  }
+  GST_OBJECT_UNLOCK (element);
+
+  pad = gst_pad_new_from_template (templ, "results");
+  gst_pad_use_fixed_caps (pad);
+  gst_pad_set_element_private (pad, rp);
+  gst_pad_set_query_function (pad,
+      GST_DEBUG_FUNCPTR (gst_aubio_results_pad_query));
+  gst_pad_set_active (pad, TRUE);
+
+  /* sticky, sent downstream once the pad is linked */
+  stream_id = gst_pad_create_stream_id (pad, element, "results");
+  gst_pad_push_event (pad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+  caps = gst_caps_new_empty_simple (media_type);
+  gst_pad_set_caps (pad, caps);
+  gst_caps_unref (caps);
+
+  GST_OBJECT_LOCK (element);
+  rp->pad = pad;
+  rp->need_segment = TRUE;
+  GST_OBJECT_UNLOCK (element);
+
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+void
+gst_aubio_results_pad_release (GstAubioResultsPad * rp, GstElement * element,
+    GstPad * pad)
+{
+  GST_OBJECT_LOCK (element);
+  if (rp->pad != pad) {
+    GST_OBJECT_UNLOCK (element);
+    return;
+  }
+  rp->pad = NULL;
+  GST_OBJECT_UNLOCK (element);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
+void
+gst_aubio_results_pad_begin (GstAubioResultsPad * rp, GstElement * element,
+    guint max_results)
+{
+  GST_OBJECT_LOCK (element);
+  rp->active = rp->pad ? gst_object_ref (rp->pad) : NULL;
+  GST_OBJECT_UNLOCK (element);
+
+  rp->len = 0;
+  rp->size = 0;
+  rp->records = NULL;
+
+  if (rp->active == NULL || max_results == 0)
+    return;
+
+  rp->records = g_new (GstAubioResult, max_results);
+  rp->size = max_results;
+}
+
+void
+gst_aubio_results_pad_append (GstAubioResultsPad * rp,
+    const GstAubioResult * result)
+{
+  if (rp->len >= rp->size) {
+    if (rp->active == NULL)
+      return;
+    /* more results than announced, such as replayed ones */
+    rp->size = MAX (rp->size * 2, 16);
+    rp->records = g_renew (GstAubioResult, rp->records, rp->size);
+  }
+
+  rp->records[rp->len++] = *result;
+}
+
+void
+gst_aubio_results_pad_finish (GstAubioResultsPad * rp, GstSegment * segment)
+{
+  GstBuffer *buffer;
+  GstFlowReturn ret;
+
+  if (rp->active == NULL)
+    return;
+
+  if (rp->len > 0) {
+    if (rp->need_segment) {
+      gst_pad_push_event (rp->active, gst_event_new_segment (segment));
+      rp->need_segment = FALSE;
+    }
+
+    /* the records become the memory of the buffer, without a copy */
+    buffer = gst_buffer_new_wrapped (rp->records,
+        rp->len * sizeof (GstAubioResult));
+    GST_BUFFER_PTS (buffer) = rp->records[0].timestamp;
+    rp->records = NULL;
+
+    ret = gst_pad_push (rp->active, buffer);
+    if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED) {
+      GST_DEBUG_OBJECT (rp->active, "pushing results: %s",
+          gst_flow_get_name (ret));
+    }
+  } else {
+    g_free (rp->records);
+  }
+
+  gst_object_unref (rp->active);
+  rp->active = NULL;
+  rp->records = NULL;
+  rp->len = rp->size = 0;
+}
+
+void
+gst_aubio_results_pad_event (GstAubioResultsPad * rp, GstElement * element,
+    GstEvent * event)
+{
+  GstPad *pad;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEGMENT:
+    case GST_EVENT_EOS:
+    case GST_EVENT_FLUSH_START:
+    case GST_EVENT_FLUSH_STOP:
+      break;
+    default:
+      /* the rest describes the audio, not the results */
+      return;
+  }
+
+  GST_OBJECT_LOCK (element);
+  pad = rp->pad ? gst_object_ref (rp->pad) : NULL;
+  if (pad && GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT)
+    rp->need_segment = FALSE;
+  GST_OBJECT_UNLOCK (element);
+
+  if (pad == NULL)
+    return;
+
+  gst_pad_push_event (pad, gst_event_ref (event));
+  gst_object_unref (pad);
+}
+
+/* set the delay between the analysed audio and the results, telling the
+ * pipeline to query the latency again when it changes */
+void
+gst_aubio_results_pad_set_latency (GstAubioResultsPad * rp,
+    GstElement * element, GstClockTime latency)
+{
+  gboolean changed;
+
+  GST_OBJECT_LOCK (element);
+  changed = rp->latency != latency;
+  rp->latency = latency;
+  GST_OBJECT_UNLOCK (element);
+
+  if (changed) {
+    GST_DEBUG_OBJECT (element, "analysis latency %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (latency));
+    gst_element_post_message (element,
+        gst_message_new_latency (GST_OBJECT (element)));
+  }
+}
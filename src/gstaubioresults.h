@@ -0,0 +1,87 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __GST_AUBIO_RESULTS_H__
+#define __GST_AUBIO_RESULTS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* what a GstAubioResult describes */
+typedef enum
+{
+  GST_AUBIO_RESULT_PITCH,
+  GST_AUBIO_RESULT_BEAT,
+  GST_AUBIO_RESULT_ONSET
+} GstAubioResultKind;
+
+/* a single analysis result, also the record layout of the buffers pushed
+ * on the results pad, in native byte order */
+typedef struct
+{
+  GstClockTime timestamp;       /* time of the analysed audio */
+  gfloat value;                 /* pitch in Hz, bpm for beats, position
+                                 * within its hop in hops for onsets */
+  gfloat confidence;            /* of the detector, 0 when it has none */
+  guint32 channel;              /* analysed channel the result belongs to */
+  guint32 kind;                 /* a GstAubioResultKind */
+  GstClockTime emitted;         /* time of the last sample needed to get
+                                 * the result */
+} GstAubioResult;
+
+/* optional request src pad carrying the results as a data stream, one
+ * buffer of packed GstAubioResult records per input buffer */
+typedef struct
+{
+  GstPad *pad;                  /* protected by the element object lock */
+  gboolean need_segment;
+  GstClockTime latency;         /* protected by the element object lock */
+
+  /* set between _begin and _finish on the streaming thread */
+  GstPad *active;
+  GstAubioResult *records;      /* handed over to the buffer pushed */
+  guint len;
+  guint size;
+} GstAubioResultsPad;
+
+void gst_aubio_value_array_append (GValue * array, GType type,
+    gconstpointer v);
+
+GstPad * gst_aubio_results_pad_request (GstAubioResultsPad * rp,
+    GstElement * element, GstPadTemplate * templ, const gchar * media_type);
+void gst_aubio_results_pad_release (GstAubioResultsPad * rp,
+    GstElement * element, GstPad * pad);
+
+void gst_aubio_results_pad_begin (GstAubioResultsPad * rp,
+    GstElement * element, guint max_results);
+void gst_aubio_results_pad_append (GstAubioResultsPad * rp,
+    const GstAubioResult * result);
+void gst_aubio_results_pad_finish (GstAubioResultsPad * rp,
+    GstSegment * segment);
+void gst_aubio_results_pad_event (GstAubioResultsPad * rp,
+    GstElement * element, GstEvent * event);
+void gst_aubio_results_pad_set_latency (GstAubioResultsPad * rp,
+    GstElement * element, GstClockTime latency);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_RESULTS_H__ */
@@ -0,0 +1,145 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstaubioring.h"
+
+void
+gst_aubio_ring_init (GstAubioRing * ring)
+{
+  g_mutex_init (&ring->lock);
+  ring->records = NULL;
+  ring->size = 0;
+  ring->head = 0;
+  ring->tail = 0;
+  ring->dropped = 0;
+}
+
+void
+gst_aubio_ring_clear (GstAubioRing * ring)
+{
+  g_free (ring->records);
+  ring->records = NULL;
+  g_mutex_clear (&ring->lock);
+}
+
+void
+gst_aubio_ring_set_size (GstAubioRing * ring, guint size)
+{
+  g_mutex_lock (&ring->lock);
+  g_free (ring->records);
+  ring->records = NULL;
+  ring->size = 0;
+  if (size > 0) {
+    ring->size = 1U << g_bit_storage (size - 1);
+    ring->records = g_new (GstAubioResult, ring->size);
+  }
+  g_atomic_int_set (&ring->head, 0);
+  g_atomic_int_set (&ring->tail, 0);
+  g_atomic_int_set (&ring->dropped, 0);
+  g_mutex_unlock (&ring->lock);
+}
+
+gboolean
+gst_aubio_ring_configure (GstAubioRing * ring, GstElement * element,
+    guint size)
+{
+  gboolean streaming;
+
+  /* under the object lock, so that no state change starts the streaming
+   * while the ring is resized */
+  GST_OBJECT_LOCK (element);
+  streaming = GST_STATE (element) > GST_STATE_READY
+      || GST_STATE_NEXT (element) > GST_STATE_READY;
+  if (!streaming)
+    gst_aubio_ring_set_size (ring, size);
+  GST_OBJECT_UNLOCK (element);
+
+  if (streaming) {
+    GST_WARNING_OBJECT (element, "ring-size can only be changed in the "
+        "NULL and READY states");
+  }
+
+  return !streaming;
+}
+
+void
+gst_aubio_ring_push (GstAubioRing * ring, const GstAubioResult * result)
+{
+  guint head, tail;
+
+  if (ring->size == 0)
+    return;
+
+  /* only this thread moves head */
+  head = ring->head;
+  tail = g_atomic_int_get (&ring->tail);
+  if (head - tail >= ring->size) {
+    g_atomic_int_inc (&ring->dropped);
+    return;
+  }
+
+  ring->records[head & (ring->size - 1)] = *result;
+  /* publish the record to readers once it is complete */
+  g_atomic_int_set (&ring->head, head + 1);
+}
+
+GstBuffer *
+gst_aubio_ring_pull (GstAubioRing * ring, GstObject * element)
+{
+  GstAubioResult *records;
+  guint head, tail, start, n, first;
+  guint dropped;
+
+  g_mutex_lock (&ring->lock);
+  head = g_atomic_int_get (&ring->head);
+  tail = ring->tail;
+  n = head - tail;
+  if (n == 0) {
+    g_mutex_unlock (&ring->lock);
+    return NULL;
+  }
+
+  /* copy out in at most two runs, the pending records may wrap around */
+  records = g_new (GstAubioResult, n);
+  start = tail & (ring->size - 1);
+  first = MIN (n, ring->size - start);
+  memcpy (records, ring->records + start, first * sizeof (GstAubioResult));
+  memcpy (records + first, ring->records, (n - first)
+      * sizeof (GstAubioResult));
+  /* hand the slots back to the writer */
+  g_atomic_int_set (&ring->tail, head);
+  dropped = g_atomic_int_and (&ring->dropped, 0);
+  g_mutex_unlock (&ring->lock);
+
+  if (dropped) {
+    GST_WARNING_OBJECT (element, "%u results lost, the result ring was full",
+        dropped);
+  }
+
+  return gst_buffer_new_wrapped (records, n * sizeof (GstAubioResult));
+}
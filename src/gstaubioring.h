@@ -0,0 +1,71 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GST_AUBIO_RING_H__
+#define __GST_AUBIO_RING_H__
+
+#include <gst/gst.h>
+
+#include "gstaubioresults.h"
+
+G_BEGIN_DECLS
+
+/* Bounded ring of results, filled by the thread reporting them and
+ * drained by the application from any thread with the pull-results action
+ * signal of the elements.
+ *
+ * There is a single writer at a time, the streaming thread or the worker,
+ * which never blocks or takes a lock: it only publishes head once the
+ * record is written, and drops the result when the ring is full. Readers
+ * only move tail, and are serialised by a mutex of their own. */
+/* largest ring an element can be given */
+#define GST_AUBIO_RING_MAX_SIZE (1 << 20)
+
+typedef struct
+{
+  GMutex lock;                  /* serialises readers and resizing */
+  GstAubioResult *records;
+  guint size;                   /* a power of two, 0 when disabled */
+  volatile gint head;           /* results written, by the writer */
+  volatile gint tail;           /* results read, by readers */
+  volatile guint dropped;       /* results lost since the last pull */
+} GstAubioRing;
+
+void gst_aubio_ring_init (GstAubioRing * ring);
+void gst_aubio_ring_clear (GstAubioRing * ring);
+
+/* make room for size results, rounded up to a power of two, 0 disables
+ * the ring; pending results are discarded. Only while no results are
+ * pushed */
+void gst_aubio_ring_set_size (GstAubioRing * ring, guint size);
+/* set_size for the ring-size property of element, refused with FALSE once
+ * element is leaving READY for PAUSED or above */
+gboolean gst_aubio_ring_configure (GstAubioRing * ring, GstElement * element,
+    guint size);
+void gst_aubio_ring_push (GstAubioRing * ring, const GstAubioResult * result);
+/* all pending results as a buffer of packed GstAubioResult records, as on
+ * the results pad, or NULL when there are none */
+GstBuffer * gst_aubio_ring_pull (GstAubioRing * ring, GstObject * element);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_RING_H__ */
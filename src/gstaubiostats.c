@@ -0,0 +1,119 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "gstaubiostats.h"
+
+GST_DEBUG_CATEGORY (gst_aubio_trace_debug);
+
+void
+gst_aubio_stats_init (GstAubioStats * stats)
+{
+  stats->enabled = FALSE;
+  g_mutex_init (&stats->lock);
+  stats->hops = 0;
+  stats->results = 0;
+  stats->time = 0;
+  stats->max_time = 0;
+  stats->bytes = 0;
+  stats->dropped = 0;
+}
+
+void
+gst_aubio_stats_clear (GstAubioStats * stats)
+{
+  g_mutex_clear (&stats->lock);
+}
+
+void
+gst_aubio_stats_set_enabled (GstAubioStats * stats, gboolean enabled)
+{
+  g_atomic_int_set (&stats->enabled, enabled);
+}
+
+void
+gst_aubio_stats_hop (GstAubioStats * stats, GstObject * element,
+    guint channel, GstClockTime time, guint results)
+{
+  if (g_atomic_int_get (&stats->enabled)) {
+    g_mutex_lock (&stats->lock);
+    if (time != GST_CLOCK_TIME_NONE) {
+      stats->hops++;
+      stats->time += time;
+      stats->max_time = MAX (stats->max_time, time);
+    }
+    stats->results += results;
+    g_mutex_unlock (&stats->lock);
+  }
+
+  GST_CAT_LOG_OBJECT (gst_aubio_trace_debug, element,
+      "hop channel=%u time=%" G_GINT64_FORMAT " results=%u", channel,
+      time != GST_CLOCK_TIME_NONE ? (gint64) time : (gint64) -1, results);
+}
+
+void
+gst_aubio_stats_buffer (GstAubioStats * stats, guint bytes)
+{
+  if (!g_atomic_int_get (&stats->enabled))
+    return;
+
+  g_mutex_lock (&stats->lock);
+  stats->bytes += bytes;
+  g_mutex_unlock (&stats->lock);
+}
+
+void
+gst_aubio_stats_dropped (GstAubioStats * stats, GstObject * element,
+    guint hops)
+{
+  if (g_atomic_int_get (&stats->enabled)) {
+    g_mutex_lock (&stats->lock);
+    stats->dropped += hops;
+    g_mutex_unlock (&stats->lock);
+  }
+
+  GST_CAT_LOG_OBJECT (gst_aubio_trace_debug, element, "dropped hops=%u",
+      hops);
+}
+
+GstStructure *
+gst_aubio_stats_get (GstAubioStats * stats)
+{
+  GstStructure *s;
+
+  g_mutex_lock (&stats->lock);
+  s = gst_structure_new (GST_AUBIO_STATS_NAME,
+      "hops", G_TYPE_UINT64, stats->hops,
+      "results", G_TYPE_UINT64, stats->results,
+      "total-time", G_TYPE_UINT64, stats->time,
+      "average-time", G_TYPE_UINT64,
+      stats->hops ? stats->time / stats->hops : (guint64) 0,
+      "max-time", G_TYPE_UINT64, stats->max_time,
+      "bytes", G_TYPE_UINT64, stats->bytes,
+      "dropped-hops", G_TYPE_UINT64, stats->dropped, NULL);
+  g_mutex_unlock (&stats->lock);
+
+  return s;
+}
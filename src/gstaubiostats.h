@@ -0,0 +1,81 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GST_AUBIO_STATS_H__
+#define __GST_AUBIO_STATS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* debug category of the per hop trace, "aubiotrace", set to LOG to get a
+ * line per detector run. GstTracer only hooks the core's own probe points
+ * and the registration of new ones is private, so the trace of the
+ * analysis loop goes through the debug log instead. */
+GST_DEBUG_CATEGORY_EXTERN (gst_aubio_trace_debug);
+
+/* name of the structure of the stats property */
+#define GST_AUBIO_STATS_NAME "aubio-stats"
+
+/* Running counters of an element, updated from the streaming thread and
+ * the worker while enabled. */
+typedef struct
+{
+  volatile gint enabled;        /* collect the counters */
+  GMutex lock;
+  guint64 hops;         /* detector runs */
+  guint64 results;      /* results reported */
+  guint64 time;         /* ns spent in the detectors */
+  guint64 max_time;     /* longest run */
+  guint64 bytes;        /* audio received */
+  guint64 dropped;      /* hops dropped by a full async queue */
+} GstAubioStats;
+
+void gst_aubio_stats_init (GstAubioStats * stats);
+void gst_aubio_stats_clear (GstAubioStats * stats);
+void gst_aubio_stats_set_enabled (GstAubioStats * stats, gboolean enabled);
+
+/* whether anything listens to the hops: the counters are collected or the
+ * trace is on. When not, the detectors need not be timed. */
+static inline gboolean
+gst_aubio_stats_active (GstAubioStats * stats)
+{
+  return g_atomic_int_get (&stats->enabled)
+      || gst_debug_category_get_threshold (gst_aubio_trace_debug)
+      >= GST_LEVEL_LOG;
+}
+
+/* account for one hop of one channel: time is what the detector took, or
+ * GST_CLOCK_TIME_NONE when it was not run, results what the hop gave.
+ * These do nothing unless gst_aubio_stats_active(). */
+void gst_aubio_stats_hop (GstAubioStats * stats, GstObject * element,
+    guint channel, GstClockTime time, guint results);
+void gst_aubio_stats_buffer (GstAubioStats * stats, guint bytes);
+void gst_aubio_stats_dropped (GstAubioStats * stats, GstObject * element,
+    guint hops);
+
+/* the counters as a new GST_AUBIO_STATS_NAME structure */
+GstStructure * gst_aubio_stats_get (GstAubioStats * stats);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_STATS_H__ */
@@ -26,8 +26,8 @@
  * <title>Example launch line</title>
  * <para>
  * <programlisting>
- * gst-launch -v -m audiotestsrc ! aubiotempo ! fakesink
- * gst-launch filesrc location=audiofile ! decodebin ! audioconvert ! \
+ * gst-launch-1.0 -v -m audiotestsrc ! aubiotempo ! fakesink
+ * gst-launch-1.0 filesrc location=audiofile ! decodebin ! audioconvert ! \
  *      aubiotempo silent=FALSE ! audioconvert ! autoaudiosink
  * </programlisting>
  * </para>
@@ -38,24 +38,21 @@
 #  include <config.h>
 #endif
 
+#include <string.h>
+
 #include <gst/gst.h>
 #include <gst/audio/audio.h>
 
 #include "gstaubiotempo.h"
+#include "gstaubiometa.h"
 
 GST_DEBUG_CATEGORY_STATIC(aubiotempo_debug);
 #define GST_CAT_DEFAULT aubiotempo_debug
 
-static const GstElementDetails element_details = 
-GST_ELEMENT_DETAILS ("Aubio Tempo Analysis",
-  "Filter/Analyzer/Audio",
-  "Extract tempo period and beat locations using aubio",
-  "Paul Brossier <piem@aubio.org>");
-
 /* Filter signals and args */
 enum
 {
-  /* FILL ME */
+  SIGNAL_PULL_RESULTS,
   LAST_SIGNAL
 };
 
@@ -64,59 +61,134 @@ enum
   PROP_0,
   PROP_SILENT,
   PROP_MESSAGE,
+  PROP_DOWNMIX,
+  PROP_ATTACH_ANALYSIS,
+  PROP_ASYNC,
+  PROP_QUEUE_SIZE,
+  PROP_QUEUE_POLICY,
+  PROP_SHARED_POOL,
+  PROP_METHOD,
+  PROP_BUF_SIZE,
+  PROP_HOP_SIZE,
+  PROP_THRESHOLD,
+  PROP_SILENCE,
+  PROP_GATE,
+  PROP_GATE_THRESHOLD,
+  PROP_GATE_HANGOVER,
+  PROP_DEGRADE,
+  PROP_LOW_LATENCY,
+  PROP_LATENCY,
+  PROP_STATS,
+  PROP_COLLECT_STATS,
+  PROP_CACHE_LOCATION,
+  PROP_LOG_LOCATION,
+  PROP_RING_SIZE
 };
 
-#define ALLOWED_CAPS \
-    "audio/x-raw-float,"                                              \
-    " width=(int)32,"                                                 \
-    " endianness=(int)BYTE_ORDER,"                                    \
-    " rate=(int)44100,"                                               \
-    " channels=(int)1"
+#define DEFAULT_QUEUE_SIZE 64
+#define DEFAULT_QUEUE_POLICY GST_AUBIO_QUEUE_BLOCK
+#define DEFAULT_RING_SIZE 0
+
+/* window and hop sizes at GST_AUBIO_REFERENCE_RATE, scaled to the
+ * negotiated rate in setup */
+#define DEFAULT_BUF_SIZE 1024
+#define DEFAULT_HOP_SIZE 128
+#define LOW_LATENCY_BUF_SIZE 512
+#define LOW_LATENCY_HOP_SIZE 64
+
+#define DEFAULT_METHOD "kl"
+#define DEFAULT_THRESHOLD 0.3
+#define DEFAULT_SILENCE -90.
+
+#define DEFAULT_GATE_THRESHOLD -70.
+#define DEFAULT_GATE_HANGOVER 8
+
+/* pending changes of the analysis settings */
+#define RECONFIGURE_TUNE  (1 << 0)  /* peak picking or silence threshold */
+#define RECONFIGURE_BUILD (1 << 1)  /* method or sizes, needs new trackers */
 
-GST_BOILERPLATE (GstAubioTempo, gst_aubio_tempo, GstAudioFilter,
-    GST_TYPE_AUDIO_FILTER);
+#define ALLOWED_CAPS                                                  \
+    GST_AUDIO_CAPS_MAKE ("{ " GST_AUDIO_NE (F32) ", "                 \
+        GST_AUDIO_NE (F64) ", " GST_AUDIO_NE (S16) ", "               \
+        GST_AUDIO_NE (S32) " }")                                      \
+    ", layout=(string)interleaved"
+
+static GstStaticPadTemplate results_template =
+GST_STATIC_PAD_TEMPLATE ("results",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("application/x-aubio-tempo"));
+
+#define gst_aubio_tempo_parent_class parent_class
+G_DEFINE_TYPE (GstAubioTempo, gst_aubio_tempo, GST_TYPE_AUDIO_FILTER);
+
+static guint gst_aubio_tempo_signals[LAST_SIGNAL] = { 0 };
 
 static void gst_aubio_tempo_finalize (GObject * obj);
 static void gst_aubio_tempo_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_aubio_tempo_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static GstBuffer *gst_aubio_tempo_pull_results (GstAubioTempo * filter);
 
+static gboolean gst_aubio_tempo_setup (GstAudioFilter * audiofilter,
+        const GstAudioInfo * info);
+static gboolean gst_aubio_tempo_stop (GstBaseTransform * trans);
+static gboolean gst_aubio_tempo_sink_event (GstBaseTransform * trans,
+        GstEvent * event);
+static gboolean gst_aubio_tempo_src_event (GstBaseTransform * trans,
+        GstEvent * event);
 static GstFlowReturn gst_aubio_tempo_transform_ip (GstBaseTransform * trans,
         GstBuffer * buf);
 
+static GstPad *gst_aubio_tempo_request_new_pad (GstElement * element,
+        GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_aubio_tempo_release_pad (GstElement * element, GstPad * pad);
+
+static void gst_aubio_tempo_worker_func (GstAubioHop * hop,
+        gpointer user_data);
+static void gst_aubio_tempo_drain_hop (GstAubioTempo * filter);
+static void gst_aubio_tempo_end_chunk (GstAubioTempo * filter);
+static void gst_aubio_tempo_start_cache (GstAubioTempo * filter);
+static gboolean gst_aubio_tempo_start_log (GstAubioTempo * filter);
+
 /* GObject vmethod implementations */
+
+/* initialize the plugin's class */
 static void
-gst_aubio_tempo_base_init (gpointer gclass)
+gst_aubio_tempo_class_init (GstAubioTempoClass * klass)
 {
-  GstElementClass *element_class = GST_ELEMENT_CLASS (gclass);
-
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+  GstAudioFilterClass *filter_class = GST_AUDIO_FILTER_CLASS (klass);
   GstCaps *caps;
 
   caps = gst_caps_from_string (ALLOWED_CAPS);
-
-  gst_audio_filter_class_add_pad_templates (GST_AUDIO_FILTER_CLASS (gclass),
-        caps);
-
+  gst_audio_filter_class_add_pad_templates (filter_class, caps);
   gst_caps_unref (caps);
 
-  gst_element_class_set_details (element_class, &element_details);
+  gst_element_class_add_static_pad_template (element_class,
+      &results_template);
 
-}
+  gst_element_class_set_static_metadata (element_class,
+      "Aubio Tempo Analysis",
+      "Filter/Analyzer/Audio",
+      "Extract tempo period and beat locations using aubio",
+      "Paul Brossier <piem@aubio.org>");
 
-/* initialize the plugin's class */
-static void
-gst_aubio_tempo_class_init (GstAubioTempoClass * klass)
-{
-  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
-  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
-  //GstAudioFilterClass *filter_class = GST_AUDIO_FILTER_CLASS (klass);
+  filter_class->setup = GST_DEBUG_FUNCPTR (gst_aubio_tempo_setup);
 
-  //trans_class->stop = GST_DEBUG_FUNCPTR (gst_aubio_tempo_stop);
-  //trans_class->event = GST_DEBUG_FUNCPTR (gst_aubio_tempo_event);
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_aubio_tempo_stop);
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_aubio_tempo_sink_event);
+  trans_class->src_event = GST_DEBUG_FUNCPTR (gst_aubio_tempo_src_event);
   trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_aubio_tempo_transform_ip);
   trans_class->passthrough_on_same_caps = TRUE;
 
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_aubio_tempo_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_aubio_tempo_release_pad);
+
   gobject_class->finalize = gst_aubio_tempo_finalize;
   gobject_class->set_property = gst_aubio_tempo_set_property;
   gobject_class->get_property = gst_aubio_tempo_get_property;
@@ -129,43 +201,516 @@ gst_aubio_tempo_class_init (GstAubioTempoClass * klass)
       g_param_spec_boolean ("message", "Message", "Emit gstreamer messages",
           TRUE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_DOWNMIX,
+      g_param_spec_boolean ("downmix", "Downmix",
+          "Analyse the average of all channels instead of each channel",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_ATTACH_ANALYSIS,
+      g_param_spec_boolean ("attach-analysis", "Attach analysis",
+          "Attach the beats found in each buffer to it as a "
+          "GstAubioAnalysisMeta, not with async=TRUE", FALSE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_ASYNC,
+      g_param_spec_boolean ("async", "Async",
+          "Analyse on a worker thread instead of the streaming thread",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_QUEUE_SIZE,
+      g_param_spec_uint ("queue-size", "Queue size",
+          "Number of hops the worker thread can lag behind in async mode",
+          1, G_MAXUINT, DEFAULT_QUEUE_SIZE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_QUEUE_POLICY,
+      g_param_spec_enum ("queue-policy", "Queue policy",
+          "What to do with new hops when the async queue is full",
+          GST_TYPE_AUBIO_QUEUE_POLICY, DEFAULT_QUEUE_POLICY,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_SHARED_POOL,
+      g_param_spec_boolean ("shared-pool", "Shared pool",
+          "In async mode, analyse on the thread pool shared by all aubio "
+          "elements instead of a thread of our own (the pool size is set "
+          "with the " GST_AUBIO_THREADS_ENV " environment variable)",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_METHOD,
+      g_param_spec_string ("method", "Method",
+          "Onset detection function the beats are tracked on (kl, hfc, "
+          "energy, complex, phase, specdiff, mkl, specflux)",
+          DEFAULT_METHOD, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_BUF_SIZE,
+      g_param_spec_uint ("buf-size", "Buffer size",
+          "Analysis window in frames (0 = scale 1024 at 44100 Hz to the rate)",
+          0, G_MAXINT, 0, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_HOP_SIZE,
+      g_param_spec_uint ("hop-size", "Hop size",
+          "Frames between two analyses (0 = scale 128 at 44100 Hz to the rate)",
+          0, G_MAXINT, 0, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_THRESHOLD,
+      g_param_spec_float ("threshold", "Threshold",
+          "Peak picking threshold of the onset detection function",
+          0., G_MAXFLOAT, DEFAULT_THRESHOLD,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_SILENCE,
+      g_param_spec_float ("silence", "Silence",
+          "Level in dB below which no beat is reported",
+          -200., 0., DEFAULT_SILENCE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_GATE,
+      g_param_spec_boolean ("gate", "Gate",
+          "Skip the analysis of hops quieter than gate-threshold",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_GATE_THRESHOLD,
+      g_param_spec_float ("gate-threshold", "Gate threshold",
+          "RMS level in dB below which hops are not searched for beats",
+          -200., 0., DEFAULT_GATE_THRESHOLD,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_GATE_HANGOVER,
+      g_param_spec_uint ("gate-hangover", "Gate hangover",
+          "Number of hops still analysed after the level drops below "
+          "gate-threshold", 0, G_MAXUINT, DEFAULT_GATE_HANGOVER,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_DEGRADE,
+      g_param_spec_boolean ("degrade", "Degrade",
+          "Analyse on longer hops while the analysis cannot keep up with "
+          "the stream, posting an " GST_AUBIO_QUALITY_NAME " message at each "
+          "change", FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_LOW_LATENCY,
+      g_param_spec_boolean ("low-latency", "Low latency",
+          "Default to the smallest usable window and hop, and push results "
+          "after every hop instead of every buffer",
+          FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY,
+      g_param_spec_uint64 ("latency", "Latency",
+          "Largest delay in nanoseconds between a beat and the end of the "
+          "hop it is reported at", 0, G_MAXUINT64, 0, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Hops analysed, beats, time spent in the tracker, bytes "
+          "received and hops dropped while collect-stats is TRUE",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_COLLECT_STATS,
+      g_param_spec_boolean ("collect-stats", "Collect statistics",
+          "Update the counters of the stats property", FALSE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_CACHE_LOCATION,
+      g_param_spec_string ("cache-location", "Cache location",
+          "Directory of the results of audio analysed before, replayed "
+          "instead of analysing the same audio again (NULL = no cache)",
+          NULL, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_LOG_LOCATION,
+      g_param_spec_string ("log-location", "Log location",
+          "File the results are appended to as binary records, readable "
+          "while it is written (NULL = no log)",
+          NULL, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring size",
+          "Number of results kept for the pull-results action signal, "
+          "rounded up to a power of two, newer results are dropped when "
+          "it is full (0 = no ring)", 0, GST_AUBIO_RING_MAX_SIZE,
+          DEFAULT_RING_SIZE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstAubioTempo::pull-results:
+   *
+   * Takes all the results kept since the last call, as a buffer of packed
+   * GstAubioResult records in the order they were found, or NULL when
+   * there are none. Can be emitted from any thread, needs ring-size.
+   */
+  gst_aubio_tempo_signals[SIGNAL_PULL_RESULTS] =
+      g_signal_new ("pull-results", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstAubioTempoClass, pull_results), NULL, NULL, NULL,
+      GST_TYPE_BUFFER, 0, G_TYPE_NONE);
+
+  klass->pull_results = gst_aubio_tempo_pull_results;
+
   GST_DEBUG_CATEGORY_INIT (aubiotempo_debug, "aubiotempo", 0,
           "Aubio tempo extraction");
 
 }
 
 static void
-gst_aubio_tempo_init (GstAubioTempo * filter,
-    GstAubioTempoClass * gclass)
+gst_aubio_tempo_init (GstAubioTempo * filter)
 {
 
   filter->silent = TRUE;
   filter->message = TRUE;
+  filter->downmix = FALSE;
+  filter->attach_analysis = FALSE;
+  filter->beats = g_array_new (FALSE, FALSE, sizeof (gint64));
+  filter->beat_channels = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  filter->async = FALSE;
+  filter->queue_size = DEFAULT_QUEUE_SIZE;
+  filter->queue_policy = DEFAULT_QUEUE_POLICY;
+  filter->shared_pool = FALSE;
+  filter->worker = NULL;
+
+  filter->method = g_strdup (DEFAULT_METHOD);
+  filter->conf_buf_size = 0;
+  filter->conf_hop_size = 0;
+  filter->threshold = DEFAULT_THRESHOLD;
+  filter->silence_threshold = DEFAULT_SILENCE;
+  filter->low_latency = FALSE;
+  filter->reconfigure = 0;
+
+  filter->gate = FALSE;
+  filter->gate_threshold = DEFAULT_GATE_THRESHOLD;
+  filter->gate_hangover = DEFAULT_GATE_HANGOVER;
+  filter->gate_hold = NULL;
+  filter->gated = NULL;
+  filter->spare = NULL;
+
+  filter->degrade = FALSE;
+  gst_aubio_qos_reset (&filter->qos, GST_ELEMENT (filter));
+  gst_aubio_stats_init (&filter->stats);
+
+  filter->cache_location = NULL;
+  gst_aubio_disk_cache_init (&filter->disk_cache);
 
-  filter->buf_size = 1024;
-  filter->hop_size = 128;
-  filter->channels = 1;
+  filter->log_location = NULL;
+  gst_aubio_log_init (&filter->result_log);
 
-  filter->last_beat = -1;
-  filter->bpm = 0;
+  filter->ring_size = DEFAULT_RING_SIZE;
+  gst_aubio_ring_init (&filter->ring);
 
-  filter->ibuf = new_fvec(filter->hop_size);
+  filter->buf_size = DEFAULT_BUF_SIZE;
+  filter->hop_size = DEFAULT_HOP_SIZE;
+  filter->samplerate = GST_AUBIO_REFERENCE_RATE;
+  filter->latency = 0;
+
+  filter->resync = TRUE;
+  filter->fresh = FALSE;
+  filter->start_time = 0;
+  filter->frames = 0;
+
+  /* trackers are created in setup, once the channel count is known */
+  filter->channels = 0;
+  filter->t = NULL;
+  filter->ibuf = NULL;
+  filter->bpm = NULL;
+  filter->last_beat = NULL;
   filter->out = new_fvec(2);
-  filter->t = new_aubio_tempo("kl",
-          filter->buf_size, filter->hop_size, 44100);
 }
 
 static void
-gst_aubio_tempo_finalize (GObject * obj)
+gst_aubio_tempo_free_analysers (GstAubioTempo * filter)
 {
-  GstAubioTempo * aubio_tempo = GST_AUBIOTEMPO (obj);
+  uint i;
+
+  if (filter->worker) {
+    gst_aubio_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+
+  for (i = 0; i < filter->channels; i++) {
+    if (filter->t[i]) {
+      del_aubio_tempo(filter->t[i]);
+    }
+    if (filter->spare[i]) {
+      del_aubio_tempo(filter->spare[i]);
+    }
+    if (filter->ibuf[i]) {
+      del_fvec(filter->ibuf[i]);
+    }
+  }
+  g_free (filter->t);
+  g_free (filter->ibuf);
+  g_free (filter->gate_hold);
+  g_free (filter->gated);
+  g_free (filter->spare);
+  g_free (filter->bpm);
+  g_free (filter->last_beat);
+
+  filter->t = NULL;
+  filter->ibuf = NULL;
+  filter->bpm = NULL;
+  filter->last_beat = NULL;
+  filter->gate_hold = NULL;
+  filter->gated = NULL;
+  filter->spare = NULL;
+  filter->channels = 0;
+}
+
+/* (re)create the trackers of the analysed channels from the current
+ * settings. On failure, the previous trackers are kept. */
+static gboolean
+gst_aubio_tempo_build (GstAubioTempo * filter, uint channels)
+{
+  aubio_tempo_t **t;
+  gchar *method;
+  uint buf_size, hop_size;
+  gfloat threshold, silence;
+  gboolean low_latency, restart;
+  uint i;
+
+  GST_OBJECT_LOCK (filter);
+  method = g_strdup (filter->method);
+  buf_size = filter->conf_buf_size;
+  hop_size = filter->conf_hop_size;
+  threshold = filter->threshold;
+  silence = filter->silence_threshold;
+  low_latency = filter->low_latency;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (buf_size == 0)
+    buf_size = gst_aubio_scale_size (low_latency ? LOW_LATENCY_BUF_SIZE
+        : DEFAULT_BUF_SIZE, filter->samplerate);
+  if (hop_size == 0)
+    hop_size = gst_aubio_scale_size (low_latency ? LOW_LATENCY_HOP_SIZE
+        : DEFAULT_HOP_SIZE, filter->samplerate);
+  /* degraded analysis runs on longer hops, with the same window */
+  if (filter->degrade)
+    hop_size = gst_aubio_qos_hop_size (&filter->qos, hop_size, buf_size);
+
+  t = g_new0 (aubio_tempo_t *, channels);
+  for (i = 0; i < channels; i++) {
+    t[i] = new_aubio_tempo (method, buf_size, hop_size, filter->samplerate);
+    if (t[i] == NULL) {
+      GST_WARNING_OBJECT (filter, "could not create %s tempo tracker, "
+          "buf_size %u, hop_size %u", method, buf_size, hop_size);
+      while (i--)
+        del_aubio_tempo (t[i]);
+      g_free (t);
+      g_free (method);
+      return FALSE;
+    }
+    aubio_tempo_set_threshold (t[i], threshold);
+    aubio_tempo_set_silence (t[i], silence);
+  }
+
+  /* let the worker finish the hops queued with the previous trackers */
+  restart = filter->worker != NULL;
+  if (filter->worker) {
+    gst_aubio_worker_drain (filter->worker);
+    gst_aubio_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+
+  for (i = 0; i < filter->channels; i++) {
+    del_aubio_tempo (filter->t[i]);
+    if (filter->spare[i])
+      del_aubio_tempo (filter->spare[i]);
+    del_fvec (filter->ibuf[i]);
+  }
+  g_free (filter->t);
+  g_free (filter->ibuf);
+  g_free (filter->gate_hold);
+  g_free (filter->gated);
+  g_free (filter->spare);
+
+  filter->t = t;
+  filter->ibuf = g_new0 (fvec_t *, channels);
+  filter->gate_hold = g_new0 (guint, channels);
+  filter->gated = g_new0 (gboolean, channels);
+  filter->spare = g_new0 (aubio_tempo_t *, channels);
+  filter->channels = channels;
+  filter->buf_size = buf_size;
+  filter->hop_size = hop_size;
+  filter->pos = 0;
+
+  for (i = 0; i < channels; i++) {
+    filter->ibuf[i] = new_fvec(filter->hop_size);
+  }
+
+  /* a beat is reported up to two hops after it */
+  filter->latency = GST_FRAMES_TO_CLOCK_TIME (2 * hop_size,
+      filter->samplerate);
+  gst_aubio_results_pad_set_latency (&filter->results, GST_ELEMENT (filter),
+      filter->latency);
+
+  /* the tempo estimate carries over to the new trackers */
+  if (filter->bpm == NULL) {
+    filter->bpm = g_new0 (gdouble, channels);
+    filter->last_beat = g_new (gdouble, channels);
+    for (i = 0; i < channels; i++) {
+      filter->last_beat[i] = -1;
+    }
+  }
+
+  if (restart) {
+    filter->worker = gst_aubio_worker_new ("aubiotempo", filter->queue_size,
+        filter->channels, filter->hop_size, filter->shared_pool,
+        gst_aubio_tempo_worker_func, filter);
+  }
 
-  if (aubio_tempo->t) {
-    del_aubio_tempo(aubio_tempo->t);
+  filter->fresh = TRUE;
+
+  GST_DEBUG_OBJECT (filter, "%s on %u channels at %u Hz, "
+      "buf_size %u, hop_size %u", method, filter->channels,
+      filter->samplerate, filter->buf_size, filter->hop_size);
+
+  g_free (method);
+
+  return TRUE;
+}
+
+/* apply the settings changed since the last hop, called between two hops
+ * with remaining frames of the current buffer left to analyse */
+static void
+gst_aubio_tempo_reconfigure (GstAubioTempo * filter, guint remaining)
+{
+  gint changes;
+  gfloat threshold, silence;
+  uint i;
+
+  GST_OBJECT_LOCK (filter);
+  changes = filter->reconfigure;
+  filter->reconfigure = 0;
+  threshold = filter->threshold;
+  silence = filter->silence_threshold;
+  GST_OBJECT_UNLOCK (filter);
+
+  /* results from here on no longer match the cache entry */
+  if (filter->disk_cache.state != GST_AUBIO_DISK_CACHE_OFF) {
+    gst_aubio_tempo_end_chunk (filter);
+    gst_aubio_disk_cache_stop (&filter->disk_cache);
   }
-  if (aubio_tempo->ibuf) {
-    del_fvec(aubio_tempo->ibuf);
+
+  if (changes & RECONFIGURE_BUILD) {
+    /* the results of this buffer so far were sized for the previous
+     * hop size */
+    gboolean sync = filter->worker == NULL;
+
+    if (sync) {
+      gst_aubio_results_pad_finish (&filter->results,
+          &GST_BASE_TRANSFORM (filter)->segment);
+    }
+    gst_aubio_tempo_build (filter, filter->channels);
+    if (sync) {
+      gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+          remaining / filter->hop_size * filter->channels);
+    }
+  } else if (changes & RECONFIGURE_TUNE) {
+    if (filter->worker) {
+      gst_aubio_worker_drain (filter->worker);
+    }
+    for (i = 0; i < filter->channels; i++) {
+      aubio_tempo_set_threshold (filter->t[i], threshold);
+      aubio_tempo_set_silence (filter->t[i], silence);
+      if (filter->spare[i]) {
+        aubio_tempo_set_threshold (filter->spare[i], threshold);
+        aubio_tempo_set_silence (filter->spare[i], silence);
+      }
+    }
   }
+}
+
+/* forget the stream analysed so far, after a flush, a new segment or a
+ * discontinuity. Hops queued before a flush are discarded, others are
+ * analysed first. */
+static void
+gst_aubio_tempo_reset (GstAubioTempo * filter, gboolean flush)
+{
+  uint i;
+
+  filter->resync = TRUE;
+
+  if (filter->t == NULL)
+    return;
+
+  if (flush && filter->worker) {
+    gst_aubio_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+  if (flush) {
+    gst_aubio_disk_cache_stop (&filter->disk_cache);
+  } else if (filter->disk_cache.state != GST_AUBIO_DISK_CACHE_OFF) {
+    /* the cache entry covers the stream up to here */
+    gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+        filter->disk_cache.n_hops * filter->channels);
+    gst_aubio_tempo_end_chunk (filter);
+    gst_aubio_results_pad_finish (&filter->results,
+        &GST_BASE_TRANSFORM (filter)->segment);
+    gst_aubio_disk_cache_finish (&filter->disk_cache);
+  }
+  /* aubio has no way to clear a tracker, start over with new ones, unless
+   * they have not seen any audio yet, as on the segment that follows the
+   * caps */
+  if (!filter->fresh)
+    gst_aubio_tempo_build (filter, filter->channels);
+  for (i = 0; i < filter->channels; i++) {
+    filter->bpm[i] = 0.;
+    filter->last_beat[i] = -1;
+  }
+  g_array_set_size (filter->beats, 0);
+  g_array_set_size (filter->beat_channels, 0);
+}
+
+static gboolean
+gst_aubio_tempo_setup (GstAudioFilter * audiofilter,
+    const GstAudioInfo * info)
+{
+  GstAubioTempo *filter = GST_AUBIOTEMPO (audiofilter);
+
+  /* let the worker finish what was queued with the previous format */
+  if (filter->worker) {
+    gst_aubio_worker_drain (filter->worker);
+  }
+  gst_aubio_tempo_free_analysers (filter);
+
+  if (!gst_aubio_format_from_info (info, &filter->sample_format)) {
+    GST_ERROR_OBJECT (filter, "unsupported sample format");
+    return FALSE;
+  }
+
+  filter->samplerate = GST_AUDIO_INFO_RATE (info);
+  /* with attach-analysis, override passthrough_on_same_caps: the meta
+   * needs writable buffers */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter),
+      !filter->attach_analysis);
+  filter->resync = TRUE;
+
+  GST_OBJECT_LOCK (filter);
+  filter->reconfigure = 0;
+  GST_OBJECT_UNLOCK (filter);
+
+  /* one tracker per channel, or a single one on the downmixed signal */
+  if (!gst_aubio_tempo_build (filter,
+          filter->downmix ? 1 : GST_AUDIO_INFO_CHANNELS (info))) {
+    GST_ERROR_OBJECT (filter, "could not create tempo tracker");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_aubio_tempo_finalize (GObject * obj)
+{
+  GstAubioTempo * aubio_tempo = GST_AUBIOTEMPO (obj);
+
+  gst_aubio_tempo_free_analysers (aubio_tempo);
+
+  g_array_free (aubio_tempo->beats, TRUE);
+  g_array_free (aubio_tempo->beat_channels, TRUE);
+  g_free (aubio_tempo->method);
+  gst_aubio_stats_clear (&aubio_tempo->stats);
+  gst_aubio_disk_cache_free (&aubio_tempo->disk_cache);
+  g_free (aubio_tempo->cache_location);
+  gst_aubio_log_clear (&aubio_tempo->result_log);
+  g_free (aubio_tempo->log_location);
+  gst_aubio_ring_clear (&aubio_tempo->ring);
+
   if (aubio_tempo->out) {
     del_fvec(aubio_tempo->out);
   }
@@ -186,6 +731,103 @@ gst_aubio_tempo_set_property (GObject * object, guint prop_id,
     case PROP_MESSAGE:
       filter->message = g_value_get_boolean (value);
       break;
+    case PROP_DOWNMIX:
+      filter->downmix = g_value_get_boolean (value);
+      break;
+    case PROP_ATTACH_ANALYSIS:
+      filter->attach_analysis = g_value_get_boolean (value);
+      /* the meta needs writable buffers */
+      gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter),
+          !filter->attach_analysis);
+      break;
+    case PROP_ASYNC:
+      filter->async = g_value_get_boolean (value);
+      break;
+    case PROP_QUEUE_SIZE:
+      filter->queue_size = g_value_get_uint (value);
+      break;
+    case PROP_QUEUE_POLICY:
+      filter->queue_policy = g_value_get_enum (value);
+      break;
+    case PROP_SHARED_POOL:
+      filter->shared_pool = g_value_get_boolean (value);
+      break;
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->method);
+      filter->method = g_value_dup_string (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_BUF_SIZE:
+      GST_OBJECT_LOCK (filter);
+      filter->conf_buf_size = g_value_get_uint (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_HOP_SIZE:
+      GST_OBJECT_LOCK (filter);
+      filter->conf_hop_size = g_value_get_uint (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_THRESHOLD:
+      GST_OBJECT_LOCK (filter);
+      filter->threshold = g_value_get_float (value);
+      filter->reconfigure |= RECONFIGURE_TUNE;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_SILENCE:
+      GST_OBJECT_LOCK (filter);
+      filter->silence_threshold = g_value_get_float (value);
+      filter->reconfigure |= RECONFIGURE_TUNE;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_GATE:
+      filter->gate = g_value_get_boolean (value);
+      break;
+    case PROP_GATE_THRESHOLD:
+      filter->gate_threshold = g_value_get_float (value);
+      break;
+    case PROP_GATE_HANGOVER:
+      filter->gate_hangover = g_value_get_uint (value);
+      break;
+    case PROP_DEGRADE:
+      filter->degrade = g_value_get_boolean (value);
+      /* the hop size only follows the quality level while degrading */
+      GST_OBJECT_LOCK (filter);
+      if (filter->qos.level > 0)
+        filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_LOW_LATENCY:
+      GST_OBJECT_LOCK (filter);
+      filter->low_latency = g_value_get_boolean (value);
+      filter->reconfigure |= RECONFIGURE_BUILD;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_COLLECT_STATS:
+      gst_aubio_stats_set_enabled (&filter->stats,
+          g_value_get_boolean (value));
+      break;
+    case PROP_CACHE_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->cache_location);
+      filter->cache_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_LOG_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->log_location);
+      filter->log_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_RING_SIZE:
+      /* the ring is written without a lock while streaming */
+      if (gst_aubio_ring_configure (&filter->ring, GST_ELEMENT (filter),
+              g_value_get_uint (value)))
+        filter->ring_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -205,75 +847,666 @@ gst_aubio_tempo_get_property (GObject * object, guint prop_id,
     case PROP_MESSAGE:
       g_value_set_boolean (value, filter->message);
       break;
+    case PROP_DOWNMIX:
+      g_value_set_boolean (value, filter->downmix);
+      break;
+    case PROP_ATTACH_ANALYSIS:
+      g_value_set_boolean (value, filter->attach_analysis);
+      break;
+    case PROP_ASYNC:
+      g_value_set_boolean (value, filter->async);
+      break;
+    case PROP_QUEUE_SIZE:
+      g_value_set_uint (value, filter->queue_size);
+      break;
+    case PROP_QUEUE_POLICY:
+      g_value_set_enum (value, filter->queue_policy);
+      break;
+    case PROP_SHARED_POOL:
+      g_value_set_boolean (value, filter->shared_pool);
+      break;
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->method);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_BUF_SIZE:
+      g_value_set_uint (value, filter->conf_buf_size);
+      break;
+    case PROP_HOP_SIZE:
+      g_value_set_uint (value, filter->conf_hop_size);
+      break;
+    case PROP_THRESHOLD:
+      g_value_set_float (value, filter->threshold);
+      break;
+    case PROP_SILENCE:
+      g_value_set_float (value, filter->silence_threshold);
+      break;
+    case PROP_GATE:
+      g_value_set_boolean (value, filter->gate);
+      break;
+    case PROP_GATE_THRESHOLD:
+      g_value_set_float (value, filter->gate_threshold);
+      break;
+    case PROP_GATE_HANGOVER:
+      g_value_set_uint (value, filter->gate_hangover);
+      break;
+    case PROP_DEGRADE:
+      g_value_set_boolean (value, filter->degrade);
+      break;
+    case PROP_LOW_LATENCY:
+      g_value_set_boolean (value, filter->low_latency);
+      break;
+    case PROP_LATENCY:
+      g_value_set_uint64 (value, filter->latency);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_aubio_stats_get (&filter->stats));
+      break;
+    case PROP_COLLECT_STATS:
+      g_value_set_boolean (value, g_atomic_int_get (&filter->stats.enabled));
+      break;
+    case PROP_CACHE_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->cache_location);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_LOG_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->log_location);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, filter->ring_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static GstBuffer *
+gst_aubio_tempo_pull_results (GstAubioTempo * filter)
+{
+  return gst_aubio_ring_pull (&filter->ring, GST_OBJECT (filter));
+}
+
 static GstMessage *
-gst_aubio_tempo_message_new(GstAubioTempo *a, GstClockTime beat)
+gst_aubio_tempo_message_new(GstAubioTempo *a, uint channel, GstClockTime beat,
+    GstClockTime emitted)
 {
   GstStructure *s;
   s = gst_structure_new("aubiotempo", 
-          "beat", GST_TYPE_CLOCK_TIME, beat  ,
-          "bpm" , G_TYPE_DOUBLE      , a->bpm,
+          "beat"   , GST_TYPE_CLOCK_TIME, beat  ,
+          "bpm"    , G_TYPE_DOUBLE      , a->bpm[channel],
+          "channel", G_TYPE_UINT        , channel,
+          "emitted", GST_TYPE_CLOCK_TIME, emitted,
           NULL);
 
   return gst_message_new_element (GST_OBJECT (a), s);
 }
 
+/* report the output of the tracker for a hop, a beat when value, its
+ * position within the hop, is positive. end is the frame offset of the
+ * last sample of the hop */
+static void
+gst_aubio_tempo_report (GstAubioTempo * filter, uint channel, gfloat value,
+    gfloat confidence, gdouble end)
+{
+  GstClockTime beat, emitted;
+  GstAubioResult r;
+
+  if (value > 0.) {
+    gdouble now = end;
+    gdouble last_beat = filter->last_beat[channel];
+    // correction of inside buffer time
+    now += 1. - (smpl_t)filter->hop_size;
+    // correction of float period
+    now += (value - 1.)*(smpl_t)filter->hop_size;
+    now = MAX (now, 0.);
+
+    beat = filter->start_time
+        + GST_FRAMES_TO_CLOCK_TIME (now, filter->samplerate);
+    emitted = filter->start_time
+        + GST_FRAMES_TO_CLOCK_TIME (end, filter->samplerate);
+
+    if (last_beat != -1 && now > last_beat) {
+      filter->bpm[channel] = 60./(GST_FRAMES_TO_CLOCK_TIME(now - last_beat, filter->samplerate))*1.e+9;
+    } else {
+      filter->bpm[channel] = 0.;
+    }
+
+    if (filter->silent == FALSE) {
+      if (filter->channels > 1) {
+        g_print ("channel: %u | ", channel);
+      }
+      g_print ("beat: %f ", beat*1.e-9);
+      g_print ("| bpm: %f\n", filter->bpm[channel]);
+    }
+
+    GST_LOG_OBJECT (filter, "beat %" GST_TIME_FORMAT ", channel %u, bpm %3.2f",
+        GST_TIME_ARGS(beat), channel, filter->bpm[channel]);
+
+    if (filter->message) {
+      GstMessage *m = gst_aubio_tempo_message_new (filter, channel, beat,
+          emitted);
+      gst_element_post_message (GST_ELEMENT (filter), m);
+    }
+
+    r.timestamp = beat;
+    r.value = filter->bpm[channel];
+    r.confidence = confidence;
+    r.channel = channel;
+    r.kind = GST_AUBIO_RESULT_BEAT;
+    r.emitted = emitted;
+    gst_aubio_log_append (&filter->result_log, &r);
+    gst_aubio_ring_push (&filter->ring, &r);
+    if (filter->results.active) {
+      gst_aubio_results_pad_append (&filter->results, &r);
+    }
+
+    if (filter->attach_analysis && filter->worker == NULL) {
+      /* beat position in frames from the start of buf, negative when the
+       * beat fell in an earlier buffer */
+      gint64 offset = (gint64) now - (gint64) filter->buffer_offset;
+      guint c = channel;
+
+      g_array_append_val (filter->beats, offset);
+      g_array_append_val (filter->beat_channels, c);
+    }
+
+    filter->last_beat[channel] = now;
+  }
+}
+
+/* make the tracker that takes over channel when its gate reopens, with
+ * hop and frame counters that start over with the stream. Called on the
+ * first gated hop of a stretch, where no analysis runs, so the allocations
+ * stay off the analysed hops; the tracker retired at the end of the
+ * previous stretch is freed here too. */
+static void
+gst_aubio_tempo_prepare_spare (GstAubioTempo * filter, uint channel)
+{
+  aubio_tempo_t *t;
+  gchar *method;
+  gfloat threshold, silence;
+
+  if (filter->spare[channel]) {
+    del_aubio_tempo (filter->spare[channel]);
+    filter->spare[channel] = NULL;
+  }
+
+  GST_OBJECT_LOCK (filter);
+  method = g_strdup (filter->method);
+  threshold = filter->threshold;
+  silence = filter->silence_threshold;
+  GST_OBJECT_UNLOCK (filter);
+
+  t = new_aubio_tempo (method, filter->buf_size, filter->hop_size,
+      filter->samplerate);
+  g_free (method);
+  if (t == NULL) {
+    GST_WARNING_OBJECT (filter, "could not make a new tracker for "
+        "channel %u, keeping the current one across the gap", channel);
+    return;
+  }
+  aubio_tempo_set_threshold (t, threshold);
+  aubio_tempo_set_silence (t, silence);
+  filter->spare[channel] = t;
+}
+
+static void
+gst_aubio_tempo_process_hop (GstAubioTempo * filter, uint channel,
+    const fvec_t * hop, gdouble end)
+{
+  GstClockTime time;
+  gfloat value, confidence;
+
+  if (filter->gate && !gst_aubio_gate_hop (hop, filter->gate_threshold,
+          filter->gate_hangover, &filter->gate_hold[channel])) {
+    /* no beat in a quiet hop, skip the tracker. Its counters stop here,
+     * so a new one takes over when the gate reopens. */
+    if (!filter->gated[channel]) {
+      filter->gated[channel] = TRUE;
+      gst_aubio_tempo_prepare_spare (filter, channel);
+    }
+    value = 0.;
+    confidence = 0.;
+    time = GST_CLOCK_TIME_NONE;
+  } else {
+    GstClockTime start;
+    gboolean timed;
+
+    if (filter->gated[channel]) {
+      aubio_tempo_t *t = filter->t[channel];
+
+      filter->gated[channel] = FALSE;
+      if (filter->spare[channel]) {
+        /* the retired tracker is freed at the next gated stretch */
+        filter->t[channel] = filter->spare[channel];
+        filter->spare[channel] = t;
+        /* no tempo across the gap */
+        filter->last_beat[channel] = -1;
+        GST_LOG_OBJECT (filter, "new tracker on channel %u", channel);
+      }
+    }
+
+    /* timed only when something listens to the hops */
+    timed = gst_aubio_stats_active (&filter->stats);
+    start = timed ? gst_util_get_timestamp () : 0;
+    aubio_tempo_do(filter->t[channel], hop, filter->out);
+    time = timed ? gst_util_get_timestamp () - start : 0;
+    value = filter->out->data[0];
+    confidence = aubio_tempo_get_confidence (filter->t[channel]);
+  }
+
+  gst_aubio_disk_cache_add_result (&filter->disk_cache, channel, value,
+      confidence);
+  gst_aubio_tempo_report (filter, channel, value, confidence, end);
+  if (gst_aubio_stats_active (&filter->stats))
+    gst_aubio_stats_hop (&filter->stats, GST_OBJECT (filter), channel, time,
+        value > 0. ? 1 : 0);
+}
+
+/* attach the beats found in buf and the current tempo to it */
+static void
+gst_aubio_tempo_attach_analysis (GstAubioTempo * filter, GstBuffer * buf)
+{
+  /* not in place yet when attach-analysis was just set */
+  if (gst_buffer_is_writable (buf)) {
+    gst_buffer_add_aubio_tempo_analysis_meta (buf, filter->channels,
+        (const gint64 *) filter->beats->data,
+        (const guint *) filter->beat_channels->data, filter->beats->len,
+        filter->bpm);
+  } else {
+    GST_DEBUG_OBJECT (filter, "buffer not writable, analysis dropped");
+  }
+
+  g_array_set_size (filter->beats, 0);
+  g_array_set_size (filter->beat_channels, 0);
+}
+
+static gboolean
+gst_aubio_tempo_stop (GstBaseTransform * trans)
+{
+  GstAubioTempo *filter = GST_AUBIOTEMPO (trans);
+
+  /* the worker is started again by the first buffer */
+  if (filter->worker) {
+    gst_aubio_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+  GST_OBJECT_LOCK (filter);
+  if (filter->qos.level > 0)
+    filter->reconfigure |= RECONFIGURE_BUILD;
+  GST_OBJECT_UNLOCK (filter);
+  gst_aubio_qos_reset (&filter->qos, GST_ELEMENT (filter));
+  gst_aubio_disk_cache_stop (&filter->disk_cache);
+  gst_aubio_log_close (&filter->result_log);
+
+  return TRUE;
+}
+
+static gboolean
+gst_aubio_tempo_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstAubioTempo *filter = GST_AUBIOTEMPO (trans);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      gst_aubio_tempo_reset (filter, TRUE);
+      break;
+    case GST_EVENT_SEGMENT:
+      gst_aubio_tempo_reset (filter, FALSE);
+      break;
+    case GST_EVENT_EOS:
+      gst_aubio_tempo_drain_hop (filter);
+      if (filter->worker) {
+        gst_aubio_worker_drain (filter->worker);
+      }
+      break;
+    default:
+      break;
+  }
+
+  gst_aubio_results_pad_event (&filter->results, GST_ELEMENT (filter), event);
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+static gboolean
+gst_aubio_tempo_src_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstAubioTempo *filter = GST_AUBIOTEMPO (trans);
+
+  gst_aubio_qos_event (&filter->qos, GST_ELEMENT (filter), event);
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->src_event (trans, event);
+}
+
+/* analyse one hop of every channel, end is the frame offset of the last
+ * sample of the hop */
+static void
+gst_aubio_tempo_analyse_hop (GstAubioTempo * filter, fvec_t ** hops,
+    gdouble end)
+{
+  uint c;
+
+  for (c = 0; c < filter->channels; c++) {
+    gst_aubio_tempo_process_hop (filter, c, hops[c], end);
+  }
+}
+
+/* GstAubioWorkerFunc, analyses a queued hop on the worker thread */
+static void
+gst_aubio_tempo_worker_func (GstAubioHop * hop, gpointer user_data)
+{
+  GstAubioTempo *filter = GST_AUBIOTEMPO (user_data);
+
+  gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+      filter->channels);
+  gst_aubio_tempo_analyse_hop (filter, hop->channels, hop->offset);
+  gst_aubio_results_pad_finish (&filter->results,
+      &GST_BASE_TRANSFORM (filter)->segment);
+}
+
+/* report the hops of the current chunk of the disk cache, from the entry
+ * when they match it, or by analysing them */
+static void
+gst_aubio_tempo_end_chunk (GstAubioTempo * filter)
+{
+  GstAubioDiskCache *cache = &filter->disk_cache;
+  gfloat value, confidence;
+  fvec_t hop;
+  uint h, c;
+
+  switch (gst_aubio_disk_cache_end_chunk (cache)) {
+    case GST_AUBIO_DISK_CACHE_HIT:
+      for (h = 0; h < cache->n_hops; h++) {
+        for (c = 0; c < filter->channels; c++) {
+          gst_aubio_disk_cache_result (cache, h, c, &value, &confidence);
+          gst_aubio_tempo_report (filter, c, value, confidence,
+              cache->ends[h]);
+        }
+      }
+      break;
+    case GST_AUBIO_DISK_CACHE_MISS:
+      GST_DEBUG_OBJECT (filter, "stream differs from the cache entry");
+      for (h = 0; h < cache->n_hops; h++) {
+        for (c = 0; c < filter->channels; c++) {
+          gst_aubio_disk_cache_hop (cache, h, c, &hop);
+          gst_aubio_tempo_process_hop (filter, c, &hop, cache->ends[h]);
+        }
+      }
+      break;
+    default:
+      break;
+  }
+  gst_aubio_disk_cache_next_chunk (cache);
+}
+
+/* analyse or replay a hop through the disk cache */
+static void
+gst_aubio_tempo_cache_hop (GstAubioTempo * filter, fvec_t ** hops,
+    guint64 end)
+{
+  GstAubioDiskCache *cache = &filter->disk_cache;
+
+  gst_aubio_disk_cache_add_hop (cache, hops, end);
+  if (!gst_aubio_disk_cache_replaying (cache)) {
+    gst_aubio_tempo_analyse_hop (filter, hops, end);
+  }
+  if (cache->n_hops == GST_AUBIO_DISK_CACHE_CHUNK) {
+    gst_aubio_tempo_end_chunk (filter);
+  }
+}
+
+/* start a new entry of the disk cache, if any, at the start of a stream */
+static void
+gst_aubio_tempo_start_cache (GstAubioTempo * filter)
+{
+  gchar *location, *params;
+
+  GST_OBJECT_LOCK (filter);
+  location = g_strdup (filter->cache_location);
+  params = g_strdup_printf ("aubiotempo %s %u %u %u %u %g %g %d %g %u",
+      filter->method, filter->buf_size, filter->hop_size, filter->samplerate,
+      filter->channels, filter->threshold, filter->silence_threshold,
+      filter->gate, filter->gate_threshold, filter->gate_hangover);
+  GST_OBJECT_UNLOCK (filter);
+
+  /* queued hops are analysed out of order with the cache */
+  if (filter->async) {
+    g_free (location);
+    location = NULL;
+  }
+  gst_aubio_disk_cache_start (&filter->disk_cache, location, params,
+      filter->channels, filter->hop_size);
+
+  g_free (location);
+  g_free (params);
+}
+
+/* open the result log, if any, and number the results that follow as a
+ * new stream */
+static gboolean
+gst_aubio_tempo_start_log (GstAubioTempo * filter)
+{
+  gchar *location;
+  gboolean ret = TRUE;
+
+  GST_OBJECT_LOCK (filter);
+  location = g_strdup (filter->log_location);
+  GST_OBJECT_UNLOCK (filter);
+
+  if (location && !gst_aubio_log_is_open (&filter->result_log)) {
+    ret = gst_aubio_log_open (&filter->result_log, GST_OBJECT (filter),
+        location);
+  }
+  if (ret) {
+    gst_aubio_log_new_stream (&filter->result_log);
+  }
+  g_free (location);
+
+  return ret;
+}
+
+/* analyse a complete hop now, or queue it for the worker thread */
+static void
+gst_aubio_tempo_dispatch_hop (GstAubioTempo * filter, fvec_t ** hops,
+    guint64 end)
+{
+  if (filter->disk_cache.state != GST_AUBIO_DISK_CACHE_OFF
+      && filter->worker == NULL) {
+    gst_aubio_tempo_cache_hop (filter, hops, end);
+    return;
+  }
+
+  if (filter->worker == NULL) {
+    gst_aubio_tempo_analyse_hop (filter, hops, end);
+  } else if (!gst_aubio_worker_push (filter->worker, hops,
+          GST_CLOCK_TIME_NONE, end, filter->queue_policy)) {
+    gst_aubio_stats_dropped (&filter->stats, GST_OBJECT (filter), 1);
+    GST_DEBUG_OBJECT (filter, "queue full, dropped hop at %" G_GUINT64_FORMAT,
+        end);
+  }
+}
+
+/* analyse the last, incomplete hop, padded with silence */
+static void
+gst_aubio_tempo_drain_hop (GstAubioTempo * filter)
+{
+  guint64 end;
+  uint c;
+
+  if (filter->t == NULL)
+    return;
+
+  if (filter->pos == 0 && filter->disk_cache.n_hops == 0) {
+    gst_aubio_disk_cache_finish (&filter->disk_cache);
+    return;
+  }
+
+  if (filter->worker == NULL) {
+    gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+        (filter->disk_cache.n_hops + 1) * filter->channels);
+  }
+
+  if (filter->pos > 0) {
+    for (c = 0; c < filter->channels; c++) {
+      memset (filter->ibuf[c]->data + filter->pos, 0,
+          (filter->hop_size - filter->pos) * sizeof (smpl_t));
+    }
+    end = filter->frames + filter->hop_size - filter->pos - 1;
+    filter->pos = 0;
+
+    gst_aubio_tempo_dispatch_hop (filter, filter->ibuf, end);
+  }
+
+  /* the last, incomplete chunk of the cache */
+  gst_aubio_tempo_end_chunk (filter);
+  gst_aubio_disk_cache_finish (&filter->disk_cache);
+
+  if (filter->worker == NULL) {
+    gst_aubio_results_pad_finish (&filter->results,
+        &GST_BASE_TRANSFORM (filter)->segment);
+    /* no buffer left to attach them to */
+    g_array_set_size (filter->beats, 0);
+    g_array_set_size (filter->beat_channels, 0);
+  }
+}
+
 static GstFlowReturn
 gst_aubio_tempo_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
 {
-  uint j;
+  guint j, len;
   GstAubioTempo *filter = GST_AUBIOTEMPO(trans);
   GstAudioFilter *audiofilter = GST_AUDIO_FILTER(trans);
+  guint channels = GST_AUDIO_FILTER_CHANNELS (audiofilter);
+  guint bpf = GST_AUDIO_FILTER_BPF (audiofilter);
+  GstMapInfo map;
+  guint8 *data;
+  fvec_t view, *viewp = &view, **hops;
 
-  gint nsamples = GST_BUFFER_SIZE (buf) / (4 * audiofilter->format.channels);
+  guint nsamples;
 
-  /* block loop */
-  for (j = 0; j < nsamples; j++) {
-    /* copy input to ibuf */
-    fvec_write_sample(filter->ibuf, ((smpl_t *) GST_BUFFER_DATA(buf))[j],
-        filter->pos);
+  if (G_UNLIKELY (filter->t == NULL))
+    return GST_FLOW_NOT_NEGOTIATED;
 
-    if (filter->pos == filter->hop_size - 1) {
-      aubio_tempo_do(filter->t, filter->ibuf, filter->out);
+  gst_aubio_stats_buffer (&filter->stats, gst_buffer_get_size (buf));
 
-      if (filter->out->data[0]> 0.) {
-        gdouble now = GST_BUFFER_OFFSET (buf);
-        // correction of inside buffer time
-        now += (smpl_t)(j - filter->hop_size + 1);
-        // correction of float period
-        now += (filter->out->data[0] - 1.)*(smpl_t)filter->hop_size;
+  if (GST_BUFFER_IS_DISCONT (buf) && !filter->resync) {
+    GST_DEBUG_OBJECT (filter, "discontinuity, dropping %u frames", filter->pos);
+    gst_aubio_tempo_reset (filter, FALSE);
+  }
+  if (filter->resync) {
+    if (!gst_aubio_tempo_start_log (filter))
+      return GST_FLOW_ERROR;
+    filter->start_time = GST_BUFFER_PTS_IS_VALID (buf) ?
+        GST_BUFFER_PTS (buf) : 0;
+    filter->frames = 0;
+    filter->resync = FALSE;
+    gst_aubio_tempo_start_cache (filter);
+  }
 
-        if (filter->last_beat != -1 && now > filter->last_beat) {
-          filter->bpm = 60./(GST_FRAMES_TO_CLOCK_TIME(now - filter->last_beat, audiofilter->format.rate))*1.e+9;
-        } else {
-          filter->bpm = 0.;
-        }
+  /* the samples are only read, mapping never copies them */
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+  data = map.data;
+  nsamples = map.size / bpf;
 
-        if (filter->silent == FALSE) {
-          g_print ("beat: %f ", GST_FRAMES_TO_CLOCK_TIME( now, audiofilter->format.rate)*1.e-9);
-          g_print ("| bpm: %f\n", filter->bpm);
-        }
+  if (filter->async && filter->worker == NULL) {
+    filter->worker = gst_aubio_worker_new ("aubiotempo", filter->queue_size,
+        filter->channels, filter->hop_size, filter->shared_pool,
+        gst_aubio_tempo_worker_func, filter);
+  }
 
-        GST_LOG_OBJECT (filter, "beat %" GST_TIME_FORMAT ", bpm %3.2f",
-            GST_TIME_ARGS(now), filter->bpm);
+  filter->buffer_offset = filter->frames;
 
-        if (filter->message) {
-          GstMessage *m = gst_aubio_tempo_message_new (filter, now);
-          gst_element_post_message (GST_ELEMENT (filter), m);
-        }
+  if (filter->worker == NULL) {
+    gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+        (filter->pos + nsamples) / filter->hop_size * filter->channels);
+  }
 
-        filter->last_beat = now;
-      }
+  if (filter->degrade) {
+    gst_aubio_qos_begin (&filter->qos);
+  }
+
+  /* hop loop, runs once per hop */
+  for (j = 0; j < nsamples; j += len) {
+    if (G_UNLIKELY (g_atomic_int_get (&filter->reconfigure))
+        && filter->pos == 0) {
+      gst_aubio_tempo_reconfigure (filter, nsamples - j);
+    }
+
+    if (channels == 1 && filter->sample_format == GST_AUBIO_FORMAT_NATIVE
+        && filter->pos == 0 && nsamples - j >= filter->hop_size) {
+      /* a full hop is available in place, analyse it without copying */
+      len = filter->hop_size;
+      view.length = len;
+      view.data = (smpl_t *) (data + j * bpf);
+      hops = &viewp;
+    } else {
+      /* convert and deinterleave as much input as fits to the channel
+       * ibufs */
+      len = MIN (filter->hop_size - filter->pos, nsamples - j);
+      gst_aubio_deinterleave (filter->ibuf, filter->pos, data + j * bpf,
+          filter->sample_format, channels, len, filter->downmix);
+      filter->pos += len;
+
+      if (filter->pos < filter->hop_size)
+        continue;
+      filter->pos = 0;
+      hops = filter->ibuf;
+    }
+
+    gst_aubio_tempo_dispatch_hop (filter, hops, filter->frames + j + len - 1);
+
+    if (filter->low_latency && filter->worker == NULL) {
+      /* push the results of this hop right away */
+      gst_aubio_results_pad_finish (&filter->results, &trans->segment);
+      gst_aubio_results_pad_begin (&filter->results, GST_ELEMENT (filter),
+          (nsamples - j - len) / filter->hop_size * filter->channels);
+    }
+  }
+
+  filter->frames += nsamples;
+  filter->fresh = FALSE;
+  gst_buffer_unmap (buf, &map);
 
-      filter->pos = -1; /* so it will be zero next j loop */
+  if (filter->worker == NULL) {
+    gst_aubio_results_pad_finish (&filter->results, &trans->segment);
+    if (filter->attach_analysis) {
+      gst_aubio_tempo_attach_analysis (filter, buf);
     }
-    filter->pos++;
+  }
+
+  if (filter->degrade && gst_aubio_qos_end (&filter->qos,
+          GST_ELEMENT (filter), GST_FRAMES_TO_CLOCK_TIME (nsamples,
+              GST_AUDIO_FILTER_RATE (audiofilter)))) {
+    /* the new level takes new detectors, from the next hop */
+    GST_OBJECT_LOCK (filter);
+    filter->reconfigure |= RECONFIGURE_BUILD;
+    GST_OBJECT_UNLOCK (filter);
   }
 
   return GST_FLOW_OK;
 }
+
+static GstPad *
+gst_aubio_tempo_request_new_pad (GstElement * element, GstPadTemplate * templ,
+    const gchar * name, const GstCaps * caps)
+{
+  GstAubioTempo *filter = GST_AUBIOTEMPO (element);
+
+  return gst_aubio_results_pad_request (&filter->results, element, templ,
+      "application/x-aubio-tempo");
+}
+
+static void
+gst_aubio_tempo_release_pad (GstElement * element, GstPad * pad)
+{
+  GstAubioTempo *filter = GST_AUBIOTEMPO (element);
+
+  gst_aubio_results_pad_release (&filter->results, element, pad);
+}
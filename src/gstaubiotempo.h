@@ -28,6 +28,15 @@
 
 #include <aubio/aubio.h>
 
+#include "gstaubioutils.h"
+#include "gstaubioqos.h"
+#include "gstaubioresults.h"
+#include "gstaubiostats.h"
+#include "gstaubiodiskcache.h"
+#include "gstaubiolog.h"
+#include "gstaubioring.h"
+#include "gstaubioworker.h"
+
 G_BEGIN_DECLS
 
 /* #defines don't like whitespacey bits */
@@ -55,24 +64,82 @@ struct _GstAubioTempo
 
   gboolean silent;
   gboolean message;
-
-  aubio_tempo_t * t;
-  fvec_t * ibuf;
+  gboolean downmix;
+  gboolean attach_analysis;
+  gboolean async;
+  guint queue_size;
+  GstAubioQueuePolicy queue_policy;
+  gboolean shared_pool;
+
+  /* analysis settings, protected by the object lock and applied at the
+   * next hop boundary */
+  gchar * method;
+  guint conf_buf_size;  /* 0 to scale the default to the rate */
+  guint conf_hop_size;  /* 0 to scale the default to the rate */
+  gfloat threshold;
+  gfloat silence_threshold;
+  gboolean low_latency; /* smallest window and per hop results */
+  volatile gint reconfigure;    /* pending changes to the settings */
+
+  /* energy gate, hops below gate_threshold (dB) are not analysed */
+  gboolean gate;
+  gfloat gate_threshold;
+  guint gate_hangover;  /* in hops */
+  guint * gate_hold;    /* per analysed channel */
+  gboolean * gated;     /* per analysed channel, tracker skipped since its
+                         * last hop */
+  aubio_tempo_t ** spare;       /* per analysed channel, made while gated to
+                                 * take over when the gate reopens */
+
+  gboolean degrade;     /* decimate the analysis when falling behind */
+  GstAubioQos qos;
+  GstAubioStats stats;
+
+  gchar * cache_location;       /* protected by the object lock */
+  GstAubioDiskCache disk_cache;
+
+  gchar * log_location;         /* protected by the object lock */
+  GstAubioLog result_log;
+
+  guint ring_size;
+  GstAubioRing ring;    /* results for pull-results */
+
+  aubio_tempo_t ** t;   /* one tracker per analysed channel */
+  fvec_t ** ibuf;       /* one hop vector per analysed channel */
   fvec_t * out;
 
   uint buf_size;
   uint hop_size;
-  uint channels;
-  signed int pos;
+  GstClockTime latency; /* from a beat to the end of its hop at most */
+  GstAubioFormat sample_format;
+  uint channels;        /* number of analysed channels */
+  uint samplerate;
+  uint pos;
+
+  /* running sample counter the hops are timed with */
+  gboolean resync;      /* take the time of the next buffer */
+  gboolean fresh;       /* no audio analysed since the detectors were built */
+  GstClockTime start_time;      /* time of the first frame counted */
+  guint64 frames;       /* frames received since then */
 
-  gdouble bpm;
-  gdouble last_beat;
+  GstAubioResultsPad results;
+  GArray * beats;           /* beat offsets found in the current buffer */
+  GArray * beat_channels;   /* and the channel of each */
+  guint64 buffer_offset;    /* frames counted before the current buffer */
+
+  GstAubioWorker * worker;  /* analysis thread in async mode */
+
+  gdouble * bpm;        /* per analysed channel */
+  gdouble * last_beat;  /* per analysed channel */
 
 };
 
 struct _GstAubioTempoClass 
 {
   GstAudioFilterClass parent_class;
+
+  /* actions */
+  GstBuffer * (*pull_results) (GstAubioTempo * filter);
 };
 
 GType gst_aubio_tempo_get_type (void);
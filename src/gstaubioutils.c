@@ -0,0 +1,502 @@
+/*
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "gstaubioutils.h"
+
+/* the copies below write samples of the native format straight to aubio
+ * vectors, so HAVE_AUBIO_DOUBLE must match the aubio headers */
+#if HAVE_AUBIO_DOUBLE
+G_STATIC_ASSERT (sizeof (smpl_t) == sizeof (gdouble));
+#else
+G_STATIC_ASSERT (sizeof (smpl_t) == sizeof (gfloat));
+#endif
+
+#if !HAVE_AUBIO_DOUBLE
+#  if defined (__AVX2__)
+#    include <immintrin.h>
+#  elif defined (__SSE2__)
+#    include <emmintrin.h>
+#  elif defined (__ARM_NEON__) || defined (__ARM_NEON)
+#    include <arm_neon.h>
+#    define GST_AUBIO_NEON 1
+#  endif
+#endif
+
+/* frames are converted through a stack buffer of this many samples before
+ * being deinterleaved */
+#define SCRATCH_SIZE 1024
+
+#define S16_SCALE (1. / 32768.)
+#define S32_SCALE (1. / 2147483648.)
+
+gboolean
+gst_aubio_format_from_info (const GstAudioInfo * info,
+    GstAubioFormat * format)
+{
+  if (GST_AUDIO_INFO_LAYOUT (info) != GST_AUDIO_LAYOUT_INTERLEAVED)
+    return FALSE;
+
+  switch (GST_AUDIO_INFO_FORMAT (info)) {
+    case GST_AUDIO_FORMAT_F32:
+      *format = GST_AUBIO_FORMAT_F32;
+      break;
+    case GST_AUDIO_FORMAT_F64:
+      *format = GST_AUBIO_FORMAT_F64;
+      break;
+    case GST_AUDIO_FORMAT_S16:
+      *format = GST_AUBIO_FORMAT_S16;
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      *format = GST_AUBIO_FORMAT_S32;
+      break;
+    default:
+      return FALSE;
+  }
+  return TRUE;
+}
+
+guint
+gst_aubio_format_width (GstAubioFormat format)
+{
+  switch (format) {
+    case GST_AUBIO_FORMAT_S16:
+      return 2;
+    case GST_AUBIO_FORMAT_F64:
+      return 8;
+    default:
+      return 4;
+  }
+}
+
+static void
+convert_f32 (smpl_t * out, const gfloat * in, guint n)
+{
+  guint i = 0;
+
+#if !HAVE_AUBIO_DOUBLE
+  memcpy (out, in, n * sizeof (smpl_t));
+  i = n;
+#endif
+  for (; i < n; i++) {
+    out[i] = in[i];
+  }
+}
+
+static void
+convert_f64 (smpl_t * out, const gdouble * in, guint n)
+{
+  guint i = 0;
+
+#if HAVE_AUBIO_DOUBLE
+  memcpy (out, in, n * sizeof (smpl_t));
+  i = n;
+#elif defined (__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    __m128 lo = _mm256_cvtpd_ps (_mm256_loadu_pd (in + i));
+    __m128 hi = _mm256_cvtpd_ps (_mm256_loadu_pd (in + i + 4));
+    _mm256_storeu_ps (out + i, _mm256_set_m128 (hi, lo));
+  }
+#elif defined (__SSE2__)
+  for (; i + 4 <= n; i += 4) {
+    __m128 lo = _mm_cvtpd_ps (_mm_loadu_pd (in + i));
+    __m128 hi = _mm_cvtpd_ps (_mm_loadu_pd (in + i + 2));
+    _mm_storeu_ps (out + i, _mm_movelh_ps (lo, hi));
+  }
+#elif defined (GST_AUBIO_NEON) && defined (__aarch64__)
+  for (; i + 4 <= n; i += 4) {
+    float32x2_t lo = vcvt_f32_f64 (vld1q_f64 (in + i));
+    float32x2_t hi = vcvt_f32_f64 (vld1q_f64 (in + i + 2));
+    vst1q_f32 (out + i, vcombine_f32 (lo, hi));
+  }
+#endif
+  for (; i < n; i++) {
+    out[i] = in[i];
+  }
+}
+
+static void
+convert_s16 (smpl_t * out, const gint16 * in, guint n)
+{
+  guint i = 0;
+
+#if HAVE_AUBIO_DOUBLE
+#elif defined (__AVX2__)
+  const __m256 scale = _mm256_set1_ps (S16_SCALE);
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i *) (in + i)));
+    _mm256_storeu_ps (out + i, _mm256_mul_ps (_mm256_cvtepi32_ps (v), scale));
+  }
+#elif defined (__SSE2__)
+  const __m128 scale = _mm_set1_ps (S16_SCALE);
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (in + i));
+    /* sign extend by placing each sample in the top half and shifting */
+    __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+    __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+    _mm_storeu_ps (out + i, _mm_mul_ps (_mm_cvtepi32_ps (lo), scale));
+    _mm_storeu_ps (out + i + 4, _mm_mul_ps (_mm_cvtepi32_ps (hi), scale));
+  }
+#elif defined (GST_AUBIO_NEON)
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v = vld1q_s16 (in + i);
+    float32x4_t lo = vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (v)));
+    float32x4_t hi = vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (v)));
+    vst1q_f32 (out + i, vmulq_n_f32 (lo, S16_SCALE));
+    vst1q_f32 (out + i + 4, vmulq_n_f32 (hi, S16_SCALE));
+  }
+#endif
+  for (; i < n; i++) {
+    out[i] = in[i] * S16_SCALE;
+  }
+}
+
+static void
+convert_s32 (smpl_t * out, const gint32 * in, guint n)
+{
+  guint i = 0;
+
+#if HAVE_AUBIO_DOUBLE
+#elif defined (__AVX2__)
+  const __m256 scale = _mm256_set1_ps (S32_SCALE);
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256 ((const __m256i *) (in + i));
+    _mm256_storeu_ps (out + i, _mm256_mul_ps (_mm256_cvtepi32_ps (v), scale));
+  }
+#elif defined (__SSE2__)
+  const __m128 scale = _mm_set1_ps (S32_SCALE);
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (in + i));
+    _mm_storeu_ps (out + i, _mm_mul_ps (_mm_cvtepi32_ps (v), scale));
+  }
+#elif defined (GST_AUBIO_NEON)
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vcvtq_f32_s32 (vld1q_s32 (in + i));
+    vst1q_f32 (out + i, vmulq_n_f32 (v, S32_SCALE));
+  }
+#endif
+  for (; i < n; i++) {
+    out[i] = in[i] * S32_SCALE;
+  }
+}
+
+static void
+convert (smpl_t * out, gconstpointer in, GstAubioFormat format, guint n)
+{
+  switch (format) {
+    case GST_AUBIO_FORMAT_F32:
+      convert_f32 (out, in, n);
+      break;
+    case GST_AUBIO_FORMAT_F64:
+      convert_f64 (out, in, n);
+      break;
+    case GST_AUBIO_FORMAT_S16:
+      convert_s16 (out, in, n);
+      break;
+    case GST_AUBIO_FORMAT_S32:
+      convert_s32 (out, in, n);
+      break;
+  }
+}
+
+static void
+deinterleave_chunk (fvec_t ** dst, guint pos, const smpl_t * src,
+    guint channels, guint len, gboolean downmix)
+{
+  guint i, c;
+
+  if (downmix) {
+    smpl_t *out = dst[0]->data + pos;
+    smpl_t scale = 1. / (smpl_t) channels;
+
+    for (i = 0; i < len; i++) {
+      smpl_t sum = 0.;
+      for (c = 0; c < channels; c++) {
+        sum += src[c];
+      }
+      out[i] = sum * scale;
+      src += channels;
+    }
+    return;
+  }
+
+  for (c = 0; c < channels; c++) {
+    const smpl_t *in = src + c;
+    smpl_t *out = dst[c]->data + pos;
+
+    for (i = 0; i < len; i++) {
+      out[i] = *in;
+      in += channels;
+    }
+  }
+}
+
+void
+gst_aubio_deinterleave (fvec_t ** dst, guint pos, gconstpointer src,
+    GstAubioFormat format, guint channels, guint len, gboolean downmix)
+{
+  smpl_t scratch[SCRATCH_SIZE];
+  guint width = gst_aubio_format_width (format);
+  const guint8 *in = src;
+  guint n;
+
+  if (channels == 1) {
+    convert (dst[0]->data + pos, src, format, len);
+    return;
+  }
+
+  if (channels > SCRATCH_SIZE) {
+    /* too wide to stage a single frame, convert sample by sample */
+    guint i, c;
+    smpl_t v, sum;
+
+    for (i = 0; i < len; i++) {
+      sum = 0.;
+      for (c = 0; c < channels; c++) {
+        convert (&v, in, format, 1);
+        in += width;
+        if (downmix) {
+          sum += v;
+        } else {
+          dst[c]->data[pos + i] = v;
+        }
+      }
+      if (downmix) {
+        dst[0]->data[pos + i] = sum / (smpl_t) channels;
+      }
+    }
+    return;
+  }
+
+  /* convert whole frames to smpl_t with the vector kernels, then split
+   * them out to the channel vectors */
+  while (len > 0) {
+    n = MIN (len, SCRATCH_SIZE / channels);
+    convert (scratch, in, format, n * channels);
+    deinterleave_chunk (dst, pos, scratch, channels, n, downmix);
+    in += n * channels * width;
+    pos += n;
+    len -= n;
+  }
+}
+
+guint
+gst_aubio_scale_size (guint size, guint rate)
+{
+  gdouble scaled = (gdouble) size * rate / GST_AUBIO_REFERENCE_RATE;
+  guint result = 1;
+
+  /* nearest power of two, in the log domain */
+  while ((gdouble) result * G_SQRT2 <= scaled) {
+    result <<= 1;
+  }
+
+  return result;
+}
+
+/* sum of a[i] * b[i] */
+static gdouble
+dot (const smpl_t * a, const smpl_t * b, guint n)
+{
+  guint i = 0;
+  gdouble sum = 0.;
+
+#if HAVE_AUBIO_DOUBLE
+#elif defined (__AVX2__)
+  {
+    __m256 acc = _mm256_setzero_ps ();
+    gfloat lanes[8];
+    guint k;
+
+    for (; i + 8 <= n; i += 8) {
+      acc = _mm256_add_ps (acc,
+          _mm256_mul_ps (_mm256_loadu_ps (a + i), _mm256_loadu_ps (b + i)));
+    }
+    _mm256_storeu_ps (lanes, acc);
+    for (k = 0; k < 8; k++) {
+      sum += lanes[k];
+    }
+  }
+#elif defined (__SSE2__)
+  {
+    __m128 acc = _mm_setzero_ps ();
+    gfloat lanes[4];
+    guint k;
+
+    for (; i + 4 <= n; i += 4) {
+      acc = _mm_add_ps (acc,
+          _mm_mul_ps (_mm_loadu_ps (a + i), _mm_loadu_ps (b + i)));
+    }
+    _mm_storeu_ps (lanes, acc);
+    for (k = 0; k < 4; k++) {
+      sum += lanes[k];
+    }
+  }
+#elif defined (GST_AUBIO_NEON)
+  {
+    float32x4_t acc = vdupq_n_f32 (0.);
+    gfloat lanes[4];
+    guint k;
+
+    for (; i + 4 <= n; i += 4) {
+      acc = vmlaq_f32 (acc, vld1q_f32 (a + i), vld1q_f32 (b + i));
+    }
+    vst1q_f32 (lanes, acc);
+    for (k = 0; k < 4; k++) {
+      sum += lanes[k];
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+
+  return sum;
+}
+
+gdouble
+gst_aubio_level (const fvec_t * v)
+{
+  gdouble sum = dot (v->data, v->data, v->length);
+
+  if (v->length == 0 || sum <= 0.)
+    return -G_MAXDOUBLE;
+
+  return 10. * log10 (sum / v->length);
+}
+
+gboolean
+gst_aubio_gate_hop (const fvec_t * hop, gdouble threshold, guint hangover,
+    guint * hold)
+{
+  if (gst_aubio_level (hop) >= threshold) {
+    *hold = hangover;
+    return TRUE;
+  }
+  if (*hold > 0) {
+    (*hold)--;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* Decimating low-pass FIR. Only the kept outputs are computed, each as the
+ * dot product of the taps with the input window ending on its sample.
+ * The input of a call is appended to the last taps - 1 samples of the
+ * previous one in buf, so that the windows are contiguous. */
+struct _GstAubioDecimator
+{
+  guint factor;
+  guint n_taps;
+  smpl_t *taps;
+  smpl_t *buf;          /* n_taps - 1 samples of history, then the input */
+  guint size;           /* room for input in buf */
+};
+
+/* taps per output sample, sets the steepness of the filter */
+#define DECIMATOR_TAPS_PER_PHASE 16
+/* cutoff as a fraction of the output Nyquist frequency */
+#define DECIMATOR_CUTOFF 0.9
+
+GstAubioDecimator *
+gst_aubio_decimator_new (guint factor)
+{
+  GstAubioDecimator *dec;
+  gdouble fc, sum = 0.;
+  gint m;
+  guint k;
+
+  g_return_val_if_fail (factor > 1, NULL);
+
+  dec = g_new0 (GstAubioDecimator, 1);
+  dec->factor = factor;
+  /* odd, so the delay is a whole number of input frames */
+  dec->n_taps = DECIMATOR_TAPS_PER_PHASE * factor + 1;
+  dec->taps = g_new (smpl_t, dec->n_taps);
+
+  /* Blackman windowed sinc */
+  fc = DECIMATOR_CUTOFF * 0.5 / factor;
+  m = (dec->n_taps - 1) / 2;
+  for (k = 0; k < dec->n_taps; k++) {
+    gdouble x = (gint) k - m;
+    gdouble w = 0.42 - 0.5 * cos (2. * G_PI * k / (dec->n_taps - 1))
+        + 0.08 * cos (4. * G_PI * k / (dec->n_taps - 1));
+    gdouble h = x == 0 ? 2. * fc : sin (2. * G_PI * fc * x) / (G_PI * x);
+
+    dec->taps[k] = h * w;
+    sum += dec->taps[k];
+  }
+  /* unity gain at DC */
+  for (k = 0; k < dec->n_taps; k++) {
+    dec->taps[k] /= sum;
+  }
+
+  return dec;
+}
+
+void
+gst_aubio_decimator_free (GstAubioDecimator * dec)
+{
+  g_free (dec->taps);
+  g_free (dec->buf);
+  g_free (dec);
+}
+
+guint
+gst_aubio_decimator_delay (GstAubioDecimator * dec)
+{
+  return (dec->n_taps - 1) / 2;
+}
+
+void
+gst_aubio_decimator_do (GstAubioDecimator * dec, const fvec_t * in,
+    fvec_t * out)
+{
+  guint hist = dec->n_taps - 1;
+  guint i, n = MIN (out->length, in->length / dec->factor);
+
+  if (dec->size < in->length) {
+    smpl_t *buf = g_new0 (smpl_t, hist + in->length);
+
+    if (dec->buf) {
+      memcpy (buf, dec->buf, hist * sizeof (smpl_t));
+      g_free (dec->buf);
+    }
+    dec->buf = buf;
+    dec->size = in->length;
+  }
+
+  memcpy (dec->buf + hist, in->data, in->length * sizeof (smpl_t));
+
+  /* the taps are symmetric, no need to reverse them. Output i ends on
+   * input sample (i + 1) * factor - 1. */
+  for (i = 0; i < n; i++) {
+    out->data[i] = dot (dec->taps, dec->buf + (i + 1) * dec->factor - 1,
+        dec->n_taps);
+  }
+
+  memmove (dec->buf, dec->buf + in->length, hist * sizeof (smpl_t));
+}
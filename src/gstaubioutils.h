@@ -0,0 +1,94 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __GST_AUBIO_UTILS_H__
+#define __GST_AUBIO_UTILS_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#include <aubio/aubio.h>
+
+G_BEGIN_DECLS
+
+/* native endian sample formats accepted on the sink pad */
+typedef enum
+{
+  GST_AUBIO_FORMAT_F32,
+  GST_AUBIO_FORMAT_F64,
+  GST_AUBIO_FORMAT_S16,
+  GST_AUBIO_FORMAT_S32
+} GstAubioFormat;
+
+/* the format whose samples can be handed to aubio without conversion */
+#if HAVE_AUBIO_DOUBLE
+#define GST_AUBIO_FORMAT_NATIVE GST_AUBIO_FORMAT_F64
+#else
+#define GST_AUBIO_FORMAT_NATIVE GST_AUBIO_FORMAT_F32
+#endif
+
+gboolean gst_aubio_format_from_info (const GstAudioInfo * info,
+    GstAubioFormat * format);
+guint gst_aubio_format_width (GstAubioFormat format);
+
+/* convert len interleaved frames of src to smpl_t and copy them into the
+ * per-channel vectors dst, starting at sample pos of each vector. When
+ * downmix is set, the channels are averaged into dst[0] instead. */
+void gst_aubio_deinterleave (fvec_t ** dst, guint pos, gconstpointer src,
+    GstAubioFormat format, guint channels, guint len, gboolean downmix);
+
+/* sample rate the default window and hop sizes are tuned for */
+#define GST_AUBIO_REFERENCE_RATE 44100
+
+/* scale a window or hop size tuned for GST_AUBIO_REFERENCE_RATE to rate,
+ * rounding to the nearest power of two so that buf_size / hop_size ratios
+ * are kept. */
+guint gst_aubio_scale_size (guint size, guint rate);
+
+/* RMS level of v in dB relative to full scale, -G_MAXDOUBLE for digital
+ * silence */
+gdouble gst_aubio_level (const fvec_t * v);
+
+/* energy gate of one channel: returns TRUE when hop should be analysed,
+ * that is when its level reaches threshold (dB) or when one of the last
+ * hangover hops did. hold keeps the state of the channel between calls
+ * and starts at 0. */
+gboolean gst_aubio_gate_hop (const fvec_t * hop, gdouble threshold,
+    guint hangover, guint * hold);
+
+/* low-pass filter and downsampler by an integer factor, keeping its
+ * history between calls */
+typedef struct _GstAubioDecimator GstAubioDecimator;
+
+GstAubioDecimator * gst_aubio_decimator_new (guint factor);
+void gst_aubio_decimator_free (GstAubioDecimator * dec);
+
+/* filter the samples of in and store every factor-th of them in out,
+ * in->length / factor samples in all */
+void gst_aubio_decimator_do (GstAubioDecimator * dec, const fvec_t * in,
+    fvec_t * out);
+
+/* delay of the filter, in input frames */
+guint gst_aubio_decimator_delay (GstAubioDecimator * dec);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_UTILS_H__ */
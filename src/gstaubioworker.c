@@ -0,0 +1,328 @@
+/*
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gstaubioworker.h"
+
+/* Single producer, single consumer ring of hops. The streaming thread
+ * fills the slot at head and publishes it by moving head, the worker
+ * thread analyses the slot at tail and releases it by moving tail. Both
+ * indexes only grow, the slot is index % slots. The mutex and conditions
+ * are only taken when a side has to sleep, which it announces in
+ * waiting first.
+ *
+ * The consumer is either a thread of its own, or a task of the process
+ * wide pool. In the latter case the worker is pushed to the pool when a
+ * hop is queued and it is not scheduled already, so at most one pool
+ * thread analyses a given worker and its hops stay in order. */
+struct _GstAubioWorker
+{
+  GstAubioHop *slots;
+  smpl_t *samples;
+  guint n_slots;
+  guint n_channels;
+  guint hop_size;
+
+  volatile gint head;
+  volatile gint tail;
+  volatile gint running;
+  volatile gint waiting;
+  volatile gint scheduled;      /* queued on or running in the pool */
+
+  GMutex lock;
+  GCond cond;
+
+  GstAubioWorkerFunc func;
+  gpointer user_data;
+  GThread *thread;              /* NULL when using the shared pool */
+};
+
+/* hops analysed by a pool task before it lets other workers run */
+#define POOL_BATCH 16
+
+static GThreadPool *gst_aubio_worker_get_pool (void);
+
+GType
+gst_aubio_queue_policy_get_type (void)
+{
+  static volatile gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_AUBIO_QUEUE_BLOCK, "Wait for the worker to catch up", "block"},
+    {GST_AUBIO_QUEUE_DROP, "Drop the hop without analysing it", "drop"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_enum_register_static ("GstAubioQueuePolicy", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+static void
+gst_aubio_worker_wake (GstAubioWorker * worker)
+{
+  if (g_atomic_int_get (&worker->waiting)) {
+    g_mutex_lock (&worker->lock);
+    g_cond_broadcast (&worker->cond);
+    g_mutex_unlock (&worker->lock);
+  }
+}
+
+/* sleep until cond () is FALSE or the worker is stopped */
+static void
+gst_aubio_worker_wait (GstAubioWorker * worker,
+    gboolean (*cond) (GstAubioWorker * worker))
+{
+  g_mutex_lock (&worker->lock);
+  g_atomic_int_inc (&worker->waiting);
+  while (cond (worker) && g_atomic_int_get (&worker->running)) {
+    g_cond_wait (&worker->cond, &worker->lock);
+  }
+  g_atomic_int_add (&worker->waiting, -1);
+  g_mutex_unlock (&worker->lock);
+}
+
+static gboolean
+gst_aubio_worker_is_empty (GstAubioWorker * worker)
+{
+  return g_atomic_int_get (&worker->head) == g_atomic_int_get (&worker->tail);
+}
+
+static gboolean
+gst_aubio_worker_is_full (GstAubioWorker * worker)
+{
+  return (guint) (g_atomic_int_get (&worker->head) -
+      g_atomic_int_get (&worker->tail)) >= worker->n_slots;
+}
+
+/* analyse the hop at tail, the queue must not be empty */
+static void
+gst_aubio_worker_process (GstAubioWorker * worker)
+{
+  guint tail = g_atomic_int_get (&worker->tail);
+
+  worker->func (&worker->slots[tail % worker->n_slots], worker->user_data);
+
+  /* release the slot only once it has been analysed, so that an empty
+   * queue also means an idle worker */
+  g_atomic_int_set (&worker->tail, tail + 1);
+  gst_aubio_worker_wake (worker);
+}
+
+static gpointer
+gst_aubio_worker_loop (gpointer data)
+{
+  GstAubioWorker *worker = data;
+
+  while (g_atomic_int_get (&worker->running)) {
+    if (gst_aubio_worker_is_empty (worker)) {
+      gst_aubio_worker_wait (worker, gst_aubio_worker_is_empty);
+      continue;
+    }
+    gst_aubio_worker_process (worker);
+  }
+
+  return NULL;
+}
+
+static void
+gst_aubio_worker_schedule (GstAubioWorker * worker)
+{
+  if (g_atomic_int_compare_and_exchange (&worker->scheduled, 0, 1)) {
+    g_thread_pool_push (gst_aubio_worker_get_pool (), worker, NULL);
+  }
+}
+
+/* GFunc of the shared pool */
+static void
+gst_aubio_worker_run (gpointer data, gpointer user_data)
+{
+  GstAubioWorker *worker = data;
+  gboolean requeue;
+  guint n;
+
+  for (n = 0; n < POOL_BATCH; n++) {
+    if (!g_atomic_int_get (&worker->running)
+        || gst_aubio_worker_is_empty (worker))
+      break;
+    gst_aubio_worker_process (worker);
+  }
+
+  if (n == POOL_BATCH && g_atomic_int_get (&worker->running)) {
+    /* still scheduled, go to the back of the pool queue */
+    g_thread_pool_push (gst_aubio_worker_get_pool (), worker, NULL);
+    return;
+  }
+
+  /* gst_aubio_worker_free waits for scheduled to drop under the lock, so
+   * clear it and wake it up in one go */
+  g_mutex_lock (&worker->lock);
+  g_atomic_int_set (&worker->scheduled, 0);
+  /* a hop queued after the last check saw scheduled still set */
+  requeue = g_atomic_int_get (&worker->running)
+      && !gst_aubio_worker_is_empty (worker)
+      && g_atomic_int_compare_and_exchange (&worker->scheduled, 0, 1);
+  g_cond_broadcast (&worker->cond);
+  g_mutex_unlock (&worker->lock);
+
+  /* unless scheduled again, the worker may be freed from here on */
+  if (requeue)
+    g_thread_pool_push (gst_aubio_worker_get_pool (), worker, NULL);
+}
+
+static GThreadPool *
+gst_aubio_worker_get_pool (void)
+{
+  static volatile gsize pool = 0;
+
+  if (g_once_init_enter (&pool)) {
+    const gchar *env = g_getenv (GST_AUBIO_THREADS_ENV);
+    gint threads = env ? atoi (env) : 0;
+
+    if (threads <= 0)
+      threads = g_get_num_processors ();
+    g_once_init_leave (&pool, (gsize) g_thread_pool_new (gst_aubio_worker_run,
+            NULL, threads, FALSE, NULL));
+  }
+  return (GThreadPool *) pool;
+}
+
+GstAubioWorker *
+gst_aubio_worker_new (const gchar * name, guint slots, guint channels,
+    guint hop_size, gboolean shared, GstAubioWorkerFunc func,
+    gpointer user_data)
+{
+  GstAubioWorker *worker;
+  guint i, c;
+
+  worker = g_new0 (GstAubioWorker, 1);
+  worker->n_slots = MAX (slots, 1);
+  worker->n_channels = channels;
+  worker->hop_size = hop_size;
+  worker->func = func;
+  worker->user_data = user_data;
+
+  worker->slots = g_new0 (GstAubioHop, worker->n_slots);
+  worker->samples = g_new0 (smpl_t, worker->n_slots * channels * hop_size);
+  for (i = 0; i < worker->n_slots; i++) {
+    GstAubioHop *hop = &worker->slots[i];
+
+    hop->vectors = g_new (fvec_t, channels);
+    hop->channels = g_new (fvec_t *, channels);
+    for (c = 0; c < channels; c++) {
+      hop->vectors[c].length = hop_size;
+      hop->vectors[c].data = worker->samples + (i * channels + c) * hop_size;
+      hop->channels[c] = &hop->vectors[c];
+    }
+  }
+
+  g_mutex_init (&worker->lock);
+  g_cond_init (&worker->cond);
+
+  worker->running = 1;
+  if (!shared) {
+    worker->thread = g_thread_new (name, gst_aubio_worker_loop, worker);
+  }
+
+  return worker;
+}
+
+/* stops the thread, hops still queued are discarded */
+void
+gst_aubio_worker_free (GstAubioWorker * worker)
+{
+  guint i;
+
+  g_mutex_lock (&worker->lock);
+  g_atomic_int_set (&worker->running, 0);
+  g_cond_broadcast (&worker->cond);
+  if (worker->thread == NULL) {
+    /* wait for the pool to be done with us */
+    while (g_atomic_int_get (&worker->scheduled)) {
+      g_cond_wait (&worker->cond, &worker->lock);
+    }
+  }
+  g_mutex_unlock (&worker->lock);
+
+  if (worker->thread) {
+    g_thread_join (worker->thread);
+  }
+
+  g_mutex_clear (&worker->lock);
+  g_cond_clear (&worker->cond);
+
+  for (i = 0; i < worker->n_slots; i++) {
+    g_free (worker->slots[i].channels);
+    g_free (worker->slots[i].vectors);
+  }
+  g_free (worker->slots);
+  g_free (worker->samples);
+  g_free (worker);
+}
+
+/* queue a copy of the hop vectors in channels; returns FALSE when the hop
+ * was dropped because the queue is full */
+gboolean
+gst_aubio_worker_push (GstAubioWorker * worker, fvec_t ** channels,
+    GstClockTime timestamp, guint64 offset, GstAubioQueuePolicy policy)
+{
+  GstAubioHop *hop;
+  guint head, c;
+
+  if (gst_aubio_worker_is_full (worker)) {
+    if (policy == GST_AUBIO_QUEUE_DROP)
+      return FALSE;
+    gst_aubio_worker_wait (worker, gst_aubio_worker_is_full);
+  }
+
+  head = g_atomic_int_get (&worker->head);
+  hop = &worker->slots[head % worker->n_slots];
+  hop->timestamp = timestamp;
+  hop->offset = offset;
+  for (c = 0; c < worker->n_channels; c++) {
+    memcpy (hop->channels[c]->data, channels[c]->data,
+        worker->hop_size * sizeof (smpl_t));
+  }
+
+  g_atomic_int_set (&worker->head, head + 1);
+  if (worker->thread) {
+    gst_aubio_worker_wake (worker);
+  } else {
+    gst_aubio_worker_schedule (worker);
+  }
+
+  return TRUE;
+}
+
+/* wait until every queued hop has been analysed */
+void
+gst_aubio_worker_drain (GstAubioWorker * worker)
+{
+  if (!gst_aubio_worker_is_empty (worker)) {
+    gst_aubio_worker_wait (worker, gst_aubio_worker_is_empty);
+  }
+}
@@ -0,0 +1,72 @@
+/*
+ 
+    Copyright (C) 2008 Paul Brossier <piem@piem.org>
+
+    This file is part of gst-aubio.
+
+    gst-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gst-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gst-aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __GST_AUBIO_WORKER_H__
+#define __GST_AUBIO_WORKER_H__
+
+#include <gst/gst.h>
+
+#include <aubio/aubio.h>
+
+G_BEGIN_DECLS
+
+/* what to do with a hop when the worker queue is full */
+typedef enum
+{
+  GST_AUBIO_QUEUE_BLOCK,
+  GST_AUBIO_QUEUE_DROP
+} GstAubioQueuePolicy;
+
+#define GST_TYPE_AUBIO_QUEUE_POLICY (gst_aubio_queue_policy_get_type ())
+GType gst_aubio_queue_policy_get_type (void);
+
+/* one queued hop of every analysed channel */
+typedef struct
+{
+  GstClockTime timestamp;       /* time of the last sample of the hop */
+  guint64 offset;               /* frame offset of the last sample */
+  fvec_t **channels;            /* one hop_size vector per channel */
+
+  /*< private >*/
+  fvec_t *vectors;
+} GstAubioHop;
+
+typedef void (*GstAubioWorkerFunc) (GstAubioHop * hop, gpointer user_data);
+
+typedef struct _GstAubioWorker GstAubioWorker;
+
+/* environment variable setting the number of threads of the shared pool,
+ * the number of processors by default */
+#define GST_AUBIO_THREADS_ENV "GST_AUBIO_THREADS"
+
+GstAubioWorker * gst_aubio_worker_new (const gchar * name, guint slots,
+    guint channels, guint hop_size, gboolean shared,
+    GstAubioWorkerFunc func, gpointer user_data);
+void gst_aubio_worker_free (GstAubioWorker * worker);
+
+gboolean gst_aubio_worker_push (GstAubioWorker * worker,
+    fvec_t ** channels, GstClockTime timestamp, guint64 offset,
+    GstAubioQueuePolicy policy);
+void gst_aubio_worker_drain (GstAubioWorker * worker);
+
+G_END_DECLS
+
+#endif /* __GST_AUBIO_WORKER_H__ */
@@ -22,6 +22,9 @@
 #include <gst/gst.h>
 #include "gstaubiotempo.h"
 #include "gstaubiopitch.h"
+#include "gstaubioanalyzer.h"
+#include "gstaubiobatchsrc.h"
+#include "gstaubiostats.h"
 #include "config.h"
 
 #define GST_CAT_DEFAULT gst_aubiotempo_debug
@@ -32,16 +35,22 @@ plugin_init (GstPlugin * plugin)
 {
   GST_DEBUG_CATEGORY_INIT (gst_aubiotempo_debug, "aubiotempo",
       0, "Aubiotempo plugin");
+  GST_DEBUG_CATEGORY_INIT (gst_aubio_trace_debug, "aubiotrace",
+      0, "Aubio per hop trace");
 
   return gst_element_register (plugin, "aubiotempo",
       GST_RANK_NONE, GST_TYPE_AUBIOTEMPO)
       && gst_element_register (plugin, "aubiopitch",
-      GST_RANK_NONE, GST_TYPE_AUBIO_PITCH);
+      GST_RANK_NONE, GST_TYPE_AUBIO_PITCH)
+      && gst_element_register (plugin, "aubioanalyzer",
+      GST_RANK_NONE, GST_TYPE_AUBIO_ANALYZER)
+      && gst_element_register (plugin, "aubiobatchsrc",
+      GST_RANK_NONE, GST_TYPE_AUBIO_BATCH_SRC);
 }
 
 GST_PLUGIN_DEFINE (GST_VERSION_MAJOR,
     GST_VERSION_MINOR,
-    "aubio",
+    aubio,
     "Aubio plugin",
     plugin_init, VERSION, "GPL", "GStreamer-aubio", "http://aubio.org/")
 